@@ -0,0 +1,17 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+class QImage;
+
+// XXH64 (xxHash, 64-bit): several GB/s on one core, good enough distribution
+// for content addressing. Not a cryptographic hash.
+quint64 xxh64(const void *data, size_t length, quint64 seed = 0);
+
+// Hash of the decoded pixels, independent of scanline padding. Size and
+// format are mixed in, so the same bytes at another geometry differ.
+quint64 hashImagePixels(const QImage &image);
+
+#endif // CONTENTHASH_H
@@ -0,0 +1,76 @@
+#ifndef DETECTIONCACHE_H
+#define DETECTIONCACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <vector>
+
+#include "DetectionEngine.h"
+
+// Content-addressed detection results that survive restarts.
+//
+// Entries are keyed by a hash of the decoded pixels plus a model key (a hash
+// of the model file's contents and the detector settings), so reopening a
+// photo skips inference, and replacing the model file invalidates everything
+// it produced. The index is a compact binary file: records are appended as
+// they are added, and the file is rewritten without superseded records
+// once it grows well past the entry limit. Thread-safe.
+class DetectionCache
+{
+public:
+    explicit DetectionCache(const QString &filePath = defaultFilePath());
+
+    // <cache location>/detections.bin
+    static QString defaultFilePath();
+
+    // Key for results from `modelPath` under `settings` (thresholds, tiling,
+    // backend...). The file is re-hashed whenever its size or mtime changes.
+    quint64 modelKey(const QString &modelPath, const QByteArray &settings);
+
+    bool lookup(quint64 imageHash, quint64 modelKey, std::vector<DetectionResult> *results);
+    void insert(quint64 imageHash, quint64 modelKey, const std::vector<DetectionResult> &results);
+
+    void setMaxEntries(int entries) { m_maxEntries = entries; }
+    int  maxEntries() const         { return m_maxEntries; }
+
+private:
+    struct Key
+    {
+        quint64 image;
+        quint64 model;
+        bool operator==(const Key &o) const { return image == o.image && model == o.model; }
+        friend size_t qHash(const Key &key, size_t seed) { return qHashMulti(seed, key.image, key.model); }
+    };
+
+    struct Entry
+    {
+        std::vector<DetectionResult> results;
+        quint64 serial = 0;              // insertion order, for eviction
+    };
+
+    struct ModelFile
+    {
+        qint64    size = -1;
+        QDateTime modified;
+        quint64   contentHash = 0;
+    };
+
+    void ensureLoaded();
+    bool appendRecord(const Key &key, const std::vector<DetectionResult> &results);
+    void compact();
+
+    QString m_filePath;
+    QMutex  m_mutex;
+    bool    m_loaded = false;
+    bool    m_fileNeedsRewrite = false;  // torn tail or incompatible header
+    QHash<Key, Entry> m_entries;
+    QHash<QString, ModelFile> m_modelFiles;
+    quint64 m_nextSerial = 0;
+    int     m_recordsOnDisk = 0;
+    int     m_maxEntries = 5000;
+};
+
+#endif // DETECTIONCACHE_H
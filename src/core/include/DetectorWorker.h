@@ -0,0 +1,72 @@
+#ifndef DETECTORWORKER_H
+#define DETECTORWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <functional>
+
+class QProcess;
+
+// Resident Python detector (liquor_detect.py --serve).
+//
+// The process is started lazily on the first request and keeps the YOLO
+// weights loaded between requests. Requests and replies are one JSON object
+// per line on stdin/stdout, matched by "id". A crashed or unresponsive worker
+// is restarted transparently; the process is shut down with the owner.
+class DetectorWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DetectorWorker(QObject *parent = nullptr);
+    ~DetectorWorker() override;
+
+    void setPythonExecutable(const QString &exe) { m_pythonExe = exe; }
+    void setScriptPath(const QString &path);
+    void setModelPath(const QString &path);
+
+    bool isRunning() const;
+
+    // Start the worker if needed and wait until the model is loaded.
+    bool ensureStarted(QString *errorMessage = nullptr);
+
+    // Round-trip a "ping" to check the worker is still answering.
+    bool ping(int timeoutMs = 2000);
+
+    // Send one "detect" request (id is filled in here) and wait for its reply.
+    // Restarts the worker once if it died before answering. `isCanceled` is
+    // polled while waiting; a cancelled request's late reply is discarded.
+    bool detect(const QJsonObject &request, QJsonObject *reply, QString *errorMessage = nullptr,
+                const std::function<bool()> &isCanceled = {});
+
+    // Ask the worker to quit, then terminate/kill it if it does not.
+    void shutdown();
+
+private:
+    bool start(QString *errorMessage);
+    bool send(const QJsonObject &message, QString *errorMessage);
+    bool waitForReply(qint64 id, int timeoutMs, QJsonObject *reply, QString *errorMessage,
+                      const std::function<bool()> &isCanceled = {});
+    bool readLine(int timeoutMs, QByteArray *line);
+    void drainStandardError();
+    QString lastErrorOutput() const;
+
+    QProcess *m_process = nullptr;
+    QString   m_pythonExe = QStringLiteral("python");
+    QString   m_scriptPath;
+    QString   m_modelPath;
+    QByteArray m_stderrTail;      // last few KB of stderr, for error messages
+    QElapsedTimer m_sinceLastReply;
+    qint64    m_nextRequestId = 1;
+
+    static constexpr int kStartupTimeoutMs     = 120000; // ultralytics import + model load
+    static constexpr int kHealthCheckIdleMs    = 30000;  // ping before use after this much idle
+    static constexpr int kShutdownTimeoutMs    = 3000;
+    static constexpr int kStderrTailBytes      = 4096;
+    static constexpr int kCancelPollMs         = 100;
+};
+
+#endif // DETECTORWORKER_H
@@ -7,20 +7,137 @@
 #include <QImage>
 #include <QVector>
 #include <QRect>
+#include <QFuture>
+#include <QPromise>
+#include <QMutex>
+#include <QCache>
+#include <atomic>
+#include <memory>
 #include <vector>
 
+#include "DetectionEngine.h"
+#include "DetectionGate.h"
+#include "DetectionCache.h"
+#include "ModelCatalog.h"
+#include "BandParallel.h"
+#include "SoftMask.h"
+#include "RedactionKernel.h"
+
+class BlurIntegral;
+class QTimer;
+class DetectorWorker;
+class QThread;
+
+// Result of one detection job, tagged with the image it was run on.
+struct DetectionOutcome
+{
+    quint64 imageGeneration = 0;
+    bool    ok = false;
+    QString errorMessage;
+    std::vector<DetectionResult> results;   // image coordinates
+    QRect   region;                         // searched area; empty for the whole image
+    bool    skippedByGate = false;          // low-resolution pre-check found nothing
+    bool    fromCache = false;              // results read from the detection cache
+    bool    adaptive  = false;              // coarse-to-fine run; see metrics
+    AdaptiveMetrics metrics;
+};
+
 class SessionController : public QObject
 {
     Q_OBJECT   // <-- THIS, not "QObject"
 
 public:
     explicit SessionController(QObject *parent = nullptr);
+    ~SessionController() override;
 
     bool loadImage(const QString &filePath);
-    bool autoBlurWithPythonDetections(int strength, QString *errorMessage = nullptr);
 
-    bool runDetection();          // (fine to leave for later, even if unused)
-    void applyBlur(int strength); // (same)
+    // Detect on a pool thread with the native engine, falling back to the
+    // Python worker. Progress text names the stage (preprocess / infer /
+    // postprocess); cancelling stops the job at the next stage boundary.
+    // Loading another image cancels the running job.
+    QFuture<DetectionOutcome> detectAsync();
+
+    // Detect only inside `region` (plus a margin) at native resolution and
+    // merge what is found into the existing boxes and mask. Cheaper than a
+    // full-image tiled pass and finds objects the downscaled pass misses.
+    QFuture<DetectionOutcome> detectInRegionAsync(const QRect &region);
+
+    // Load and warm up the native model on a pool thread so the first Detect
+    // click does not pay for it. A job started meanwhile waits for the load.
+    void preloadDetector();
+    void cancelDetection();
+
+    // Models listed in models/model-info.json, read once at startup.
+    const ModelCatalog &modelRegistry() const { return m_catalog; }
+
+    // Switch detector without restarting. The model is loaded lazily by the
+    // next job or preloadDetector(). A running job is cancelled and the
+    // current image's detections are dropped, so the next Detect runs the
+    // new model; cached results stay valid, they are keyed by model file.
+    bool selectModel(const QString &name, const QString &precision, QString *errorMessage = nullptr);
+    QString activeModelName() const;
+    QString activeModelPrecision() const;
+
+    // Apply a finished job's boxes. Refused when another image has been
+    // loaded since the job started.
+    bool applyDetectionOutcome(const DetectionOutcome &outcome, QString *errorMessage = nullptr);
+
+    // Blocking detectAsync() + applyDetectionOutcome(); re-emits the boxes
+    // if this image was already detected.
+    bool runDetection(QString *errorMessage = nullptr);
+    bool hasDetections() const { return m_hasDetectionMask; }
+
+    // Detectors keep candidates down to kCandidateConfidence; this threshold
+    // picks which of them are outlined and blurred. Changing it re-filters
+    // the stored candidates, rebuilds the mask (manual strokes are replayed)
+    // and re-emits detectionsUpdated without running inference again.
+    static constexpr float kCandidateConfidence = 0.05f;
+    void  setConfidenceThreshold(float conf);
+    float confidenceThreshold() const { return m_confidenceThreshold; }
+    quint64 imageGeneration() const { return m_imageGeneration; }
+
+    // Images whose long side reaches options.minImageSide are detected in
+    // overlapping tiles (native engine only). Takes effect on the next job.
+    void setTilingOptions(const TilingOptions &options) { m_tiling = options; }
+    const TilingOptions &tilingOptions() const { return m_tiling; }
+
+    // Coarse-to-fine mode for whole-image jobs (native engine only); replaces
+    // tiling when enabled. Defaults to "detector": { "mode": "adaptive" } in
+    // assets/config/config.json. Takes effect on the next job.
+    void setAdaptiveOptions(const AdaptiveOptions &options) { m_adaptive = options; }
+    const AdaptiveOptions &adaptiveOptions() const { return m_adaptive; }
+
+    // Optional low-resolution pre-check ("gate" in models/model-info.json).
+    // Whole-image jobs whose quick pass scores nothing near the confidence
+    // threshold return no boxes without running the full detector.
+    bool isGateEnabled() const { return m_gateEnabled; }
+    GateStats gateStats() const { return m_gate.stats(); }
+
+    // Threads the blur and blend kernels split their rows over; 0 = one per
+    // core, 1 = all on the calling thread. Shared by every session.
+    void setBlurThreadCount(int threads) { setRedactionThreadCount(threads); }
+    int  blurThreadCount() const         { return redactionThreadCount(); }
+
+    // Blurred mask regions are kept per radius for the current mask, least
+    // recently used dropped first; "blur": { "cacheMB": N } in config.json.
+    // Radii next to the one shown are blurred ahead while the slider rests.
+    void   setBlurCacheLimit(qint64 bytes);
+    qint64 blurCacheLimit() const;
+
+    // What mask regions are painted with: a box blur unless "blur":
+    // { "method": "gaussian" | "pixelate" | "fill", "color": "#rrggbb" } in
+    // config.json. The strength sets the radius; the fill ignores it.
+    void setRedactionKernel(const RedactionKernel &kernel);
+    const RedactionKernel &redactionKernel() const { return m_redactionKernel; }
+
+    // Blurs are blended by mask coverage, so antialiased selection edges
+    // stay soft; a feather radius > 0 also fades the blur out over about
+    // that many pixels inside the mask edge. Takes effect on the next blend.
+    void setMaskFeather(int radius) { m_maskFeather = qMax(0, radius); }
+    int  maskFeather() const        { return m_maskFeather; }
+
+    void applyBlur(int strength); // (fine to leave for later, even if unused)
     void applyFakeBlur(int strength);
     void applyFakeBlur(int strength, const QImage &mask);
     void adoptComputedFullBlur(const QPixmap &pixmap, int strength);
@@ -31,7 +148,7 @@ public:
 
     bool hasImage() const { return !m_original.isNull(); }
     const QString &currentImagePath() const { return m_currentImagePath; }
-    const QImage &cumulativeMask() const { return m_cumulativeBlurMask; }
+    QImage cumulativeMask() const { return m_cumulativeBlurMask.toImage(); }
     void undo();
     void redo();
     void pushState();
@@ -41,18 +158,110 @@ signals:
     void detectionsUpdated(const QVector<QRect> &boxes);
 
 private:
+    struct SharedImageSlot;
+    struct LoadedModel;
+
+    // Blur of each mask region at one radius; images[i] covers rects[i].
+    struct BlurredRegions
+    {
+        QVector<QRect>  rects;
+        QVector<QImage> images;
+    };
+
+    // Settings a job snapshots when it starts.
+    struct JobOptions
+    {
+        TilingOptions   tiling;
+        AdaptiveOptions adaptive;
+        float threshold = 0.25f;        // display threshold, for the gate
+        bool  nativeResolution = false; // region search: tile, no gate, no adaptive
+    };
+
+    // Run on the pool thread by detectAsync(); touches only thread-safe state.
+    QFuture<DetectionOutcome> startDetectionJob(const QRect &region);
+    // Starts by waiting for `previous`, the job this one replaced.
+    void runDetectionJob(QPromise<DetectionOutcome> &promise, QFuture<DetectionOutcome> previous,
+                         const QImage &image, SharedImageSlot &shared, quint64 generation,
+                         const JobOptions &options, const QRect &region);
+    // Cache lookup, gate, then native engine or Python worker. Fills in
+    // outcome.results and the fields describing how they were obtained.
+    bool detectImage(const QImage &image, SharedImageSlot &shared, const JobOptions &options,
+                     DetectionOutcome &outcome, const DetectionProgress &progress);
+    // The selected model, loading it on first use. Never null; `native` is
+    // false when the .onnx could not be loaded and Python has to be used.
+    std::shared_ptr<LoadedModel> loadedModel();
+    bool ensureGateLoaded();
+    bool detectWithPython(const QImage &image, SharedImageSlot &shared, const QString &modelPath,
+                          std::vector<DetectionResult> &results, QString *errorMessage,
+                          const DetectionProgress &progress);
+    void applyDetections(const std::vector<DetectionResult> &results);
+    void mergeRegionDetections(const std::vector<DetectionResult> &results);
+    void rebuildDetectionMask();
+    void recordManualEdit(const SoftMask &stroke, bool add);
+    void setCumulativeMask(const SoftMask &mask);
+
+    // Blur cache; entries are keyed by mask generation and radius.
+    BlurredRegions blurredRegions(int radius);
+    bool findCachedBlur(quint64 generation, int radius, BlurredRegions *regions);
+    void storeBlur(quint64 generation, int radius, const BlurredRegions &regions);
+    void invalidateBlurCache();             // call whenever m_cumulativeBlurMask changes
+    void scheduleBlurPrefetch(int strength);
+    void startBlurPrefetch();
+    void stopBlurPrefetch();
+
     QString m_currentImagePath;
     QPixmap m_original;
     QPixmap m_blurred;
-    QImage  m_cumulativeBlurMask;      // union of auto + manual
+    SoftMask m_cumulativeBlurMask;     // union of auto + manual
     bool    m_hasDetectionMask = false;
-    QVector<QRect> m_autoBoxes;
+    QVector<QRect> m_autoBoxes;             // raw detections above the threshold
+    std::vector<DetectionResult> m_rawDetections; // every candidate, with conf and class
+    float   m_confidenceThreshold = 0.25f;
+    SoftMask m_manualAddMask;               // strokes blurred by hand
+    SoftMask m_manualEraseMask;             // strokes un-blurred by hand
 
-    int     m_cachedBlurStrength = -1;
-    QPixmap m_cachedBlurredImage;
+    RedactionKernel m_redactionKernel;      // radius is set per strength
+    int     m_maskFeather = 0;              // px, see setMaskFeather()
+    std::shared_ptr<BlurIntegral> m_blurIntegral; // tables of m_original, reused by every strength
+    QCache<quint64, BlurredRegions> m_blurCache;  // cost in KB
+    mutable QMutex m_blurCacheMutex;        // the prefetch job stores into the cache too
+    std::atomic<quint64> m_maskGeneration{0};
+    QVector<QRect> m_maskRects;             // maskRegions() of the mask at m_maskRectsGeneration
+    quint64 m_maskRectsGeneration = ~quint64(0);
+    QTimer *m_prefetchTimer = nullptr;      // slider idle delay
+    int     m_prefetchStrength = 0;     // slider value the prefetch centres on
+    QFuture<void> m_prefetchJob;
+    std::atomic<bool> m_prefetchCancel{false};
 
     QVector<QPixmap> m_undoStack;
     QVector<QPixmap> m_redoStack;
+
+    quint64 m_imageGeneration = 0;          // bumped on every loadImage()
+    QFuture<DetectionOutcome> m_detectionJob;
+    QFuture<void> m_preloadJob;
+
+    ModelCatalog m_catalog;                 // models/model-info.json
+    mutable QMutex m_modelMutex;            // guards the selection and m_model, never held over a load
+    QMutex  m_modelLoadMutex;               // one load at a time, off the GUI thread
+    QString m_modelName;                    // selected registry entry
+    QString m_modelPrecision;
+    quint64 m_modelSelection = 0;           // bumped by selectModel()
+    std::shared_ptr<LoadedModel> m_model;   // null until first use after a selection
+    DetectionCache m_detectionCache;        // results by pixel hash + model, on disk
+    TilingOptions m_tiling;
+    AdaptiveOptions m_adaptive;
+
+    DetectionGate m_gate;                   // low-resolution pre-check, if configured
+    QMutex  m_gateMutex;
+    bool    m_gateLoadAttempted = false;
+    std::atomic<bool> m_gateEnabled{false};
+
+    static constexpr int   kRegionMinMargin    = 32;   // px around a region search
+    static constexpr float kRegionMergeOverlap = 0.6f; // same object: overlap over smaller box
+
+    QThread *m_detectorThread = nullptr;    // owns the Python worker's QProcess
+    DetectorWorker *m_detector = nullptr;   // resident Python detector, started lazily
+    std::shared_ptr<SharedImageSlot> m_sharedImage; // pixels handed to Python, one per image
 };
 
 #endif // SESSIONCONTROLLER_H
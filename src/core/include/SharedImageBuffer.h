@@ -0,0 +1,46 @@
+#ifndef SHAREDIMAGEBUFFER_H
+#define SHAREDIMAGEBUFFER_H
+
+#include <QString>
+#include <QImage>
+
+// Raw image pixels in a named shared-memory segment (POSIX shm_open, or a
+// Win32 file mapping), so the detector process can map them directly instead
+// of decoding a temporary PNG. Python attaches with
+// multiprocessing.shared_memory.SharedMemory(name()).
+class SharedImageBuffer
+{
+public:
+    SharedImageBuffer() = default;
+    ~SharedImageBuffer();
+
+    SharedImageBuffer(const SharedImageBuffer &) = delete;
+    SharedImageBuffer &operator=(const SharedImageBuffer &) = delete;
+
+    // Copy `image` into the segment as 32-bit BGRA rows (QImage::Format_ARGB32
+    // on little-endian). The segment is reused when it is large enough.
+    bool upload(const QImage &image, QString *errorMessage = nullptr);
+    void release();
+
+    bool isValid() const     { return m_data != nullptr; }
+    QString name() const     { return m_name; }
+    int width() const        { return m_width; }
+    int height() const       { return m_height; }
+    int stride() const       { return m_stride; }
+    static QString pixelFormat(); // channel order in memory, e.g. "bgra"
+
+private:
+    bool allocate(qsizetype size, QString *errorMessage);
+
+    QString   m_name;
+    uchar    *m_data     = nullptr;
+    qsizetype m_capacity = 0;
+    int       m_width    = 0;
+    int       m_height   = 0;
+    int       m_stride   = 0;
+#ifdef _WIN32
+    void     *m_mapping  = nullptr; // HANDLE
+#endif
+};
+
+#endif // SHAREDIMAGEBUFFER_H
@@ -0,0 +1,227 @@
+#include "DetectionCache.h"
+#include "ContentHash.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <algorithm>
+
+// File layout (QDataStream, big-endian):
+//   header:  quint32 magic, quint32 version
+//   record:  quint64 imageHash, quint64 modelKey, quint32 count,
+//            count x { qint32 x, y, w, h; float confidence; qint32 classId }
+// A later record for the same key supersedes an earlier one.
+static constexpr quint32 kMagic   = 0x43534443; // "CSDC"
+static constexpr quint32 kVersion = 1;
+static constexpr quint32 kMaxBoxesPerRecord = 100000; // sanity bound when reading
+
+static void configure(QDataStream &stream)
+{
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+static void writeRecord(QDataStream &out, quint64 image, quint64 model,
+                        const std::vector<DetectionResult> &results)
+{
+    out << image << model << quint32(results.size());
+    for (const DetectionResult &r : results) {
+        out << qint32(r.box.x()) << qint32(r.box.y())
+            << qint32(r.box.width()) << qint32(r.box.height())
+            << r.confidence << qint32(r.classId);
+    }
+}
+
+static bool readRecord(QDataStream &in, quint64 *image, quint64 *model,
+                       std::vector<DetectionResult> *results)
+{
+    quint32 count = 0;
+    in >> *image >> *model >> count;
+    if (in.status() != QDataStream::Ok || count > kMaxBoxesPerRecord)
+        return false;
+
+    results->clear();
+    results->reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        qint32 x, y, w, h, cls;
+        float conf;
+        in >> x >> y >> w >> h >> conf >> cls;
+        DetectionResult r;
+        r.box = QRect(x, y, w, h);
+        r.confidence = conf;
+        r.classId = cls;
+        results->push_back(r);
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+DetectionCache::DetectionCache(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+QString DetectionCache::defaultFilePath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("detections.bin");
+}
+
+quint64 DetectionCache::modelKey(const QString &modelPath, const QByteArray &settings)
+{
+    const QFileInfo info(modelPath);
+    const qint64 size = info.exists() ? info.size() : -1;
+    const QDateTime modified = info.lastModified();
+
+    quint64 contentHash = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        const auto it = m_modelFiles.constFind(modelPath);
+        if (it != m_modelFiles.constEnd() && it->size == size && it->modified == modified)
+            contentHash = it->contentHash;
+    }
+
+    if (!contentHash && size >= 0) {
+        QFile file(modelPath);
+        if (file.open(QIODevice::ReadOnly)) {
+            if (size == 0) {
+                contentHash = xxh64(nullptr, 0);
+            } else if (const uchar *data = file.map(0, size)) {
+                contentHash = xxh64(data, size_t(size));
+                file.unmap(const_cast<uchar *>(data));
+            } else {
+                const QByteArray bytes = file.readAll();
+                contentHash = xxh64(bytes.constData(), size_t(bytes.size()));
+            }
+
+            QMutexLocker lock(&m_mutex);
+            m_modelFiles.insert(modelPath, { size, modified, contentHash });
+        }
+    }
+
+    return xxh64(settings.constData(), size_t(settings.size()), contentHash);
+}
+
+bool DetectionCache::lookup(quint64 imageHash, quint64 modelKey, std::vector<DetectionResult> *results)
+{
+    QMutexLocker lock(&m_mutex);
+    ensureLoaded();
+
+    const auto it = m_entries.constFind({ imageHash, modelKey });
+    if (it == m_entries.constEnd())
+        return false;
+
+    *results = it->results;
+    return true;
+}
+
+void DetectionCache::insert(quint64 imageHash, quint64 modelKey, const std::vector<DetectionResult> &results)
+{
+    QMutexLocker lock(&m_mutex);
+    ensureLoaded();
+
+    const Key key{ imageHash, modelKey };
+    m_entries.insert(key, { results, m_nextSerial++ });
+
+    if (m_fileNeedsRewrite || !appendRecord(key, results) || m_recordsOnDisk > 2 * m_maxEntries)
+        compact();
+}
+
+void DetectionCache::ensureLoaded()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return; // first run
+
+    QDataStream in(&file);
+    configure(in);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion) {
+        qWarning() << "[DetectionCache] ignoring incompatible cache file" << m_filePath;
+        m_fileNeedsRewrite = true;
+        return;
+    }
+
+    Key key{};
+    std::vector<DetectionResult> results;
+    while (!in.atEnd()) {
+        // A torn last record (crash mid-append) ends the read; compact()
+        // rewrites the file without it on the next insert.
+        if (!readRecord(in, &key.image, &key.model, &results)) {
+            m_fileNeedsRewrite = true;
+            break;
+        }
+        m_entries.insert(key, { results, m_nextSerial++ });
+        ++m_recordsOnDisk;
+    }
+}
+
+bool DetectionCache::appendRecord(const Key &key, const std::vector<DetectionResult> &results)
+{
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    QDataStream out(&file);
+    configure(out);
+    if (file.size() == 0) {
+        out << kMagic << kVersion;
+    } else {
+        quint32 magic = 0, version = 0;
+        out >> magic >> version;
+        if (magic != kMagic || version != kVersion)
+            return false;
+        file.seek(file.size());
+    }
+
+    writeRecord(out, key.image, key.model, results);
+    ++m_recordsOnDisk;
+    return out.status() == QDataStream::Ok;
+}
+
+void DetectionCache::compact()
+{
+    // Newest m_maxEntries entries survive; results of replaced models age out.
+    std::vector<std::pair<quint64, Key>> order;
+    order.reserve(size_t(m_entries.size()));
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        order.push_back({ it->serial, it.key() });
+    std::sort(order.begin(), order.end(),
+              [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    if (order.size() > size_t(m_maxEntries)) {
+        for (size_t i = size_t(m_maxEntries); i < order.size(); ++i)
+            m_entries.remove(order[i].second);
+        order.resize(size_t(m_maxEntries));
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[DetectionCache] cannot write" << m_filePath << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    configure(out);
+    out << kMagic << kVersion;
+    for (auto it = order.crbegin(); it != order.crend(); ++it)
+        writeRecord(out, it->second.image, it->second.model, m_entries.value(it->second).results);
+
+    if (file.commit()) {
+        m_recordsOnDisk = int(order.size());
+        m_fileNeedsRewrite = false;
+    }
+}
@@ -0,0 +1,292 @@
+#include "DetectorWorker.h"
+
+#include <QProcess>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDeadlineTimer>
+#include <QDebug>
+
+DetectorWorker::DetectorWorker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DetectorWorker::~DetectorWorker()
+{
+    shutdown();
+}
+
+void DetectorWorker::setScriptPath(const QString &path)
+{
+    if (path == m_scriptPath)
+        return;
+    m_scriptPath = path;
+    shutdown(); // next request starts a worker with the new script
+}
+
+void DetectorWorker::setModelPath(const QString &path)
+{
+    if (path == m_modelPath)
+        return;
+    m_modelPath = path;
+    shutdown(); // the resident model is the old one
+}
+
+bool DetectorWorker::isRunning() const
+{
+    return m_process && m_process->state() == QProcess::Running;
+}
+
+bool DetectorWorker::ensureStarted(QString *errorMessage)
+{
+    if (isRunning()) {
+        // Cheap health check only after a long idle period; a busy worker has
+        // just proven it is alive by answering.
+        if (!m_sinceLastReply.isValid() || m_sinceLastReply.elapsed() < kHealthCheckIdleMs)
+            return true;
+        if (ping())
+            return true;
+
+        qDebug() << "[DetectorWorker] worker stopped answering; restarting.";
+        shutdown();
+    }
+
+    return start(errorMessage);
+}
+
+bool DetectorWorker::start(QString *errorMessage)
+{
+    shutdown();
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::SeparateChannels);
+    m_stderrTail.clear();
+
+    QStringList args;
+    args << m_scriptPath
+         << "--serve"
+         << "--model" << m_modelPath;
+
+    m_process->start(m_pythonExe, args);
+
+    if (!m_process->waitForStarted(5000)) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to start Python (%1): %2")
+                                .arg(m_pythonExe, m_process->errorString());
+        }
+        shutdown();
+        return false;
+    }
+
+    // The worker prints {"ready": true} once the model is loaded.
+    QByteArray line;
+    const QDeadlineTimer deadline(kStartupTimeoutMs);
+    while (readLine(int(deadline.remainingTime()), &line)) {
+        const QJsonObject msg = QJsonDocument::fromJson(line).object();
+        if (msg.value("ready").toBool()) {
+            m_sinceLastReply.start();
+            return true;
+        }
+    }
+
+    if (errorMessage) {
+        const QString details = lastErrorOutput();
+        *errorMessage = details.isEmpty()
+            ? QString("Python detector did not become ready.")
+            : QString("Python detector failed to start: %1").arg(details);
+    }
+    shutdown();
+    return false;
+}
+
+bool DetectorWorker::ping(int timeoutMs)
+{
+    if (!isRunning())
+        return false;
+
+    QJsonObject msg;
+    msg.insert("id", m_nextRequestId++);
+    msg.insert("cmd", "ping");
+
+    QJsonObject reply;
+    const qint64 id = msg.value("id").toInteger();
+    return send(msg, nullptr) && waitForReply(id, timeoutMs, &reply, nullptr);
+}
+
+bool DetectorWorker::detect(const QJsonObject &request, QJsonObject *reply, QString *errorMessage,
+                            const std::function<bool()> &isCanceled)
+{
+    // One retry: a worker that crashed since the last call (or during this
+    // one) is restarted and the request is sent again.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!ensureStarted(errorMessage))
+            return false;
+
+        QJsonObject msg = request;
+        const qint64 id = m_nextRequestId++;
+        msg.insert("id", id);
+        msg.insert("cmd", "detect");
+
+        QJsonObject answer;
+        if (send(msg, errorMessage) && waitForReply(id, -1, &answer, errorMessage, isCanceled)) {
+            if (!answer.value("ok").toBool()) {
+                if (errorMessage) {
+                    *errorMessage = QString("Python detector failed: %1")
+                                        .arg(answer.value("error").toString());
+                }
+                return false;
+            }
+            if (reply)
+                *reply = answer;
+            return true;
+        }
+
+        if (isRunning())
+            return false; // cancelled, or worker alive but unusable; don't loop
+
+        qDebug() << "[DetectorWorker] worker exited during request:" << lastErrorOutput();
+    }
+
+    if (errorMessage && errorMessage->isEmpty()) {
+        *errorMessage = QString("Python detector crashed: %1").arg(lastErrorOutput());
+    }
+    return false;
+}
+
+void DetectorWorker::shutdown()
+{
+    if (!m_process)
+        return;
+
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->write("{\"cmd\": \"quit\"}\n");
+        m_process->closeWriteChannel();
+
+        if (!m_process->waitForFinished(kShutdownTimeoutMs)) {
+            m_process->terminate();
+            if (!m_process->waitForFinished(kShutdownTimeoutMs)) {
+                m_process->kill();
+                m_process->waitForFinished(kShutdownTimeoutMs);
+            }
+        }
+    }
+
+    delete m_process;
+    m_process = nullptr;
+    m_sinceLastReply.invalidate();
+}
+
+bool DetectorWorker::send(const QJsonObject &message, QString *errorMessage)
+{
+    if (!isRunning()) {
+        if (errorMessage) *errorMessage = "Python detector is not running.";
+        return false;
+    }
+
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    if (m_process->write(line) != line.size() || !m_process->waitForBytesWritten(5000)) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to send request to Python detector: %1")
+                                .arg(m_process->errorString());
+        }
+        return false;
+    }
+    return true;
+}
+
+bool DetectorWorker::waitForReply(qint64 id, int timeoutMs, QJsonObject *reply, QString *errorMessage,
+                                  const std::function<bool()> &isCanceled)
+{
+    const QDeadlineTimer deadline = timeoutMs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                                  : QDeadlineTimer(timeoutMs);
+
+    QByteArray line;
+    for (;;) {
+        if (isCanceled && isCanceled()) {
+            if (errorMessage) *errorMessage = "Detection cancelled.";
+            return false;
+        }
+
+        // Wait in short slices when the caller may cancel.
+        int slice = int(deadline.remainingTime()); // -1 when forever
+        if (isCanceled && (slice < 0 || slice > kCancelPollMs))
+            slice = kCancelPollMs;
+
+        if (!readLine(slice, &line)) {
+            if (!isRunning() || deadline.hasExpired())
+                break;
+            continue;
+        }
+
+        QJsonParseError parseErr;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseErr);
+        if (parseErr.error != QJsonParseError::NoError || !doc.isObject()) {
+            qDebug() << "[DetectorWorker] ignoring non-JSON line:" << line;
+            continue;
+        }
+
+        const QJsonObject obj = doc.object();
+        if (obj.value("id").toInteger(-1) != id)
+            continue; // reply to a request we no longer wait for
+
+        m_sinceLastReply.start();
+        if (reply)
+            *reply = obj;
+        return true;
+    }
+
+    if (errorMessage) {
+        *errorMessage = isRunning()
+            ? QString("Python detector did not answer in time.")
+            : QString("Python detector exited: %1").arg(lastErrorOutput());
+    }
+    return false;
+}
+
+bool DetectorWorker::readLine(int timeoutMs, QByteArray *line)
+{
+    if (!m_process)
+        return false;
+
+    const QDeadlineTimer deadline = timeoutMs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                                  : QDeadlineTimer(timeoutMs);
+
+    while (!m_process->canReadLine()) {
+        drainStandardError();
+        if (m_process->state() != QProcess::Running)
+            return false;
+
+        const int wait = int(deadline.remainingTime()); // -1 when forever
+        if (wait == 0 || !m_process->waitForReadyRead(wait)) {
+            // waitForReadyRead fails on exit too; a final line may still be buffered
+            if (m_process->canReadLine())
+                break;
+            drainStandardError();
+            return false;
+        }
+    }
+
+    *line = m_process->readLine().trimmed();
+    return true;
+}
+
+void DetectorWorker::drainStandardError()
+{
+    if (!m_process)
+        return;
+
+    const QByteArray err = m_process->readAllStandardError();
+    if (err.isEmpty())
+        return;
+
+    m_stderrTail.append(err);
+    if (m_stderrTail.size() > kStderrTailBytes)
+        m_stderrTail = m_stderrTail.right(kStderrTailBytes);
+}
+
+QString DetectorWorker::lastErrorOutput() const
+{
+    return QString::fromLocal8Bit(m_stderrTail).trimmed();
+}
@@ -1,30 +1,174 @@
 #include "SessionController.h"
+#include "DetectorWorker.h"
+#include "SharedImageBuffer.h"
+#include "ModelCatalog.h"
+#include "ContentHash.h"
+#include "Tiling.h"
+#include "BlurIntegral.h"
+#include "ScaledBlur.h"
+#include "MaskRegions.h"
+#include "BandParallel.h"
+#include "MaskBlend.h"
+#include "RedactionKernel.h"
 
 #include <QImage>
 #include <QtMath>
+#include <algorithm>
 #include <vector>
 
 
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
-#include <QTemporaryDir>
-#include <QProcess>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QPainter>
+#include <QThread>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QDebug>
 
+// Repo root as seen from the build output (.../build/bin/Release).
+static QDir projectRootDir()
+{
+    QDir rootDir(QCoreApplication::applicationDirPath());
+    rootDir.cdUp(); // Release -> bin
+    rootDir.cdUp(); // bin -> build
+    rootDir.cdUp(); // build -> Project   (repo root)
+    return rootDir;
+}
+
+// Part of every detection cache key; bump it when what is stored for a
+// key changes, so entries written under the old meaning are not served.
+static constexpr int kDetectionCacheFormat = 2;
+
+// Slider [0..100] to a blur radius. Full strength reaches 3% of the long
+// side, so labels stay unreadable on large photos, and never less than the
+// 30 px small photos get.
+static constexpr int kMinFullStrengthRadius = 30;
+static int blurRadiusForStrength(int strength, const QSize &imageSize)
+{
+    const int longSide = std::max(imageSize.width(), imageSize.height());
+    const int fullRadius = std::max(kMinFullStrengthRadius, longSide * 3 / 100);
+    return static_cast<int>(std::sqrt(std::clamp(strength, 0, 100)) * fullRadius / 10.0);
+}
+
+// Box blurs with small radii sample the image's cached table at full
+// resolution and larger ones are blurred at reduced resolution, at about the
+// same cost. Other kernels run on the source pixels.
+static QImage redactRegionAtRadius(BlurIntegral &integral, RedactionKernel kernel,
+                                   const QRect &rect, int radius)
+{
+    if (kernel.method != RedactionMethod::Box) {
+        kernel.radius = radius;
+        return applyRedaction(integral.source(), rect, kernel)
+            .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    const int factor = blurScaleFactor(radius);
+    if (factor > 1)
+        return scaledBoxBlurRegion(integral.reduced(factor), factor, integral.size(), rect, radius);
+    return integral.blurRegion(rect, radius);
+}
+
+// Slider idle time before neighbouring radii are blurred in the background,
+// and how many distinct radii on each side of the current one.
+static constexpr int kPrefetchIdleMs = 250;
+static constexpr int kPrefetchSteps  = 2;
+
+static quint64 blurCacheKey(quint64 maskGeneration, int radius)
+{
+    return (maskGeneration << 16) | quint64(radius);
+}
+
+// Shared-memory pixels for the Python worker. Uploaded by the first job on
+// an image and reused by later ones; jobs keep the slot alive while running.
+struct SessionController::SharedImageSlot
+{
+    QMutex mutex;
+    SharedImageBuffer buffer;
+    bool uploaded = false;
+};
+
+// One registry entry, loaded. Jobs hold a reference, so selecting another
+// model while one runs only frees this when the job is done.
+struct SessionController::LoadedModel
+{
+    QString name;
+    QString onnxPath;
+    QString pytorchPath;
+    DetectionEngine engine;
+    bool native = false;
+};
+
 SessionController::SessionController(QObject *parent)
     : QObject(parent)
     , m_currentImagePath()
     , m_original()
     , m_blurred()
     , m_cumulativeBlurMask()
-    , m_cachedBlurStrength(-1)
-    , m_cachedBlurredImage()
+    , m_prefetchTimer(new QTimer(this))
+    , m_detectorThread(new QThread(this))
+    , m_detector(new DetectorWorker)
 {
+    // The worker's QProcess lives on its own thread so detection jobs can
+    // block on it without touching the GUI thread.
+    m_detector->moveToThread(m_detectorThread);
+    connect(m_detectorThread, &QThread::finished, m_detector, &QObject::deleteLater);
+    m_detectorThread->start();
+
+    const QDir rootDir = projectRootDir();
+    const QJsonObject config = loadConfig(rootDir.filePath("assets/config/config.json"));
+    QString error;
+    if (!loadModelCatalog(rootDir.filePath("models/model-info.json"), &m_catalog, &error))
+        qWarning() << "[SessionController]" << error;
+
+    // assets/config/config.json picks the precision; the registry the model.
+    if (const ModelInfo *info = m_catalog.defaultInfo())
+        m_modelName = info->name;
+    m_modelPrecision = configuredPrecision(config);
+    if (m_modelPrecision.isEmpty())
+        m_modelPrecision = m_catalog.defaultPrecision;
+
+    m_adaptive.enabled = configuredMode(config)
+                             .compare(QLatin1String("adaptive"), Qt::CaseInsensitive) == 0;
+
+    // "blur": { "threads": N }; 0 or unset = one per core
+    setBlurThreadCount(configValue(config, "blur", "threads").toInt(0));
+    // "blur": { "cacheMB": N }; blurred regions kept for recent radii
+    setBlurCacheLimit(qint64(configValue(config, "blur", "cacheMB").toInt(256)) * 1024 * 1024);
+    // "blur": { "method": "box" | "gaussian" | "pixelate" | "fill", "color": "#rrggbb" }
+    const QString method = configValue(config, "blur", "method").toString();
+    if (!method.isEmpty() && !parseRedactionMethod(method, &m_redactionKernel.method))
+        qWarning() << "[SessionController] Unknown blur method" << method << "- using box";
+    const QColor fillColor(configValue(config, "blur", "color").toString());
+    if (fillColor.isValid())
+        m_redactionKernel.color = fillColor;
+    // "blur": { "feather": N }; px the blur fades over inside the mask edge
+    setMaskFeather(configValue(config, "blur", "feather").toInt(0));
+
+    m_prefetchTimer->setSingleShot(true);
+    m_prefetchTimer->setInterval(kPrefetchIdleMs);
+    connect(m_prefetchTimer, &QTimer::timeout, this, &SessionController::startBlurPrefetch);
+
+    // Stop the resident detector with the app rather than leaving it to
+    // the destructor order of static/global objects.
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                m_detector, &DetectorWorker::shutdown);
+    }
+}
+
+SessionController::~SessionController()
+{
+    cancelDetection();
+    m_detectionJob.waitForFinished();
+    m_preloadJob.waitForFinished();
+    stopBlurPrefetch();
+
+    QMetaObject::invokeMethod(m_detector, &DetectorWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_detectorThread->quit();
+    m_detectorThread->wait();
 }
 
 bool SessionController::loadImage(const QString &filePath)
@@ -34,102 +178,27 @@ bool SessionController::loadImage(const QString &filePath)
         return false;
     }
 
+    cancelDetection();
+    ++m_imageGeneration;
+    m_sharedImage.reset();
+
+    stopBlurPrefetch();
+
     m_currentImagePath = filePath;
     m_original = pix;
     m_blurred  = pix;
-    m_cumulativeBlurMask = QImage();  // reset mask on new image
+    m_blurIntegral = std::make_shared<BlurIntegral>(pix.toImage());
+    setCumulativeMask(SoftMask());  // reset mask on new image
     m_hasDetectionMask   = false;
     m_autoBoxes.clear();
-    m_cachedBlurStrength = -1;  // invalidate cache
-    m_cachedBlurredImage = QPixmap();
+    m_rawDetections.clear();
+    m_manualAddMask   = SoftMask();
+    m_manualEraseMask = SoftMask();
     emit imagesUpdated(m_original, m_blurred);
     emit detectionsUpdated({}); // clear outlines in the view
     return true;
 }
 
-// Box blur helper using summed-area table (integral image)
-static QImage boxBlur(const QImage &src, int radius)
-{
-    if (radius <= 0 || src.isNull())
-        return src;
-
-    // Work in non-premultiplied ARGB32 for simpler math
-    QImage img = src.convertToFormat(QImage::Format_ARGB32);
-    const int w = img.width();
-    const int h = img.height();
-
-    // Use integral images for each channel to compute box sums fast
-    const int iw = w + 1;
-    const int ih = h + 1;
-    std::vector<uint64_t> sumR((size_t)iw * ih);
-    std::vector<uint64_t> sumG((size_t)iw * ih);
-    std::vector<uint64_t> sumB((size_t)iw * ih);
-    std::vector<uint64_t> sumA((size_t)iw * ih);
-
-    // Build integral tables
-    for (int y = 0; y < h; ++y) {
-        const QRgb *line = reinterpret_cast<const QRgb *>(img.constScanLine(y));
-        uint64_t rowR = 0, rowG = 0, rowB = 0, rowA = 0;
-        for (int x = 0; x < w; ++x) {
-            QRgb c = line[x];
-            rowR += qRed(c);
-            rowG += qGreen(c);
-            rowB += qBlue(c);
-            rowA += qAlpha(c);
-
-            int idx = (y + 1) * iw + (x + 1);
-            int idxAbove = y * iw + (x + 1);
-
-            sumR[idx] = sumR[idxAbove] + rowR;
-            sumG[idx] = sumG[idxAbove] + rowG;
-            sumB[idx] = sumB[idxAbove] + rowB;
-            sumA[idx] = sumA[idxAbove] + rowA;
-        }
-    }
-
-    QImage dst(w, h, QImage::Format_ARGB32);
-
-    for (int y = 0; y < h; ++y) {
-        int y1 = qMax(0, y - radius);
-        int y2 = qMin(h - 1, y + radius);
-        int yy1 = y1;
-        int yy2 = y2;
-
-        for (int x = 0; x < w; ++x) {
-            int x1 = qMax(0, x - radius);
-            int x2 = qMin(w - 1, x + radius);
-
-            int A_x1 = x1;
-            int A_y1 = yy1;
-            int A_x2 = x2;
-            int A_y2 = yy2;
-
-            // indices in integral table
-            int idxA = (A_y2 + 1) * iw + (A_x2 + 1);
-            int idxB = (A_y1)     * iw + (A_x2 + 1);
-            int idxC = (A_y2 + 1) * iw + (A_x1);
-            int idxD = (A_y1)     * iw + (A_x1);
-
-            uint64_t totalR = sumR[idxA] - sumR[idxB] - sumR[idxC] + sumR[idxD];
-            uint64_t totalG = sumG[idxA] - sumG[idxB] - sumG[idxC] + sumG[idxD];
-            uint64_t totalB = sumB[idxA] - sumB[idxB] - sumB[idxC] + sumB[idxD];
-            uint64_t totalA = sumA[idxA] - sumA[idxB] - sumA[idxC] + sumA[idxD];
-
-            int count = (x2 - x1 + 1) * (y2 - y1 + 1);
-
-            uint8_t r = static_cast<uint8_t>((totalR + count/2) / count);
-            uint8_t g = static_cast<uint8_t>((totalG + count/2) / count);
-            uint8_t b = static_cast<uint8_t>((totalB + count/2) / count);
-            uint8_t a = static_cast<uint8_t>((totalA + count/2) / count);
-
-            dst.setPixel(x, y, qRgba(r, g, b, a));
-        }
-    }
-
-    return dst.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-}
-
-
 // PLAY WITH THIS FUNCTION TO ADJUST BLUR STRENGTH/QUALITY! :)
 void SessionController::applyFakeBlur(int strength)
 {
@@ -141,60 +210,34 @@ void SessionController::applyFakeBlur(int strength)
     if (m_cumulativeBlurMask.isNull() ||
         m_cumulativeBlurMask.size() != m_original.size()) {
         m_blurred = m_original;
-        m_cachedBlurStrength = -1;
-        m_cachedBlurredImage = QPixmap();
         emit imagesUpdated(m_original, m_blurred);
         return;
     }
 
-    // Map slider [0..100] to a blur radius [0..30]
-    int radius = static_cast<int>(std::sqrt(strength) * 3.0);
-    if (radius > 30)
-        radius = 30;
+    const int radius = blurRadiusForStrength(strength, m_original.size());
 
     // Strength 0 → no blur, but KEEP the mask (so user can re-blur later)
     if (radius <= 0) {
         m_blurred = m_original;
-        m_cachedBlurStrength = -1;
-        m_cachedBlurredImage = QPixmap();
         emit imagesUpdated(m_original, m_blurred);
         return;
     }
 
-    // Cache: if same strength and mask hasn't changed, reuse
-    if (m_cachedBlurStrength == strength && !m_cachedBlurredImage.isNull()) {
-        m_blurred = m_cachedBlurredImage;
-        emit imagesUpdated(m_original, m_blurred);
-        return;
-    }
+    // Blurred regions come from the cache when this radius was seen (or
+    // prefetched) for the current mask
+    const BlurredRegions regions = blurredRegions(radius);
 
     // Start from ORIGINAL image
-    QImage base    = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    QImage blurred = boxBlur(base, radius);
-    QImage result  = base;
-
-    const int w = result.width();
-    const int h = result.height();
+    const QImage base = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage result = base;
 
-    QImage maskImg = m_cumulativeBlurMask;
-
-    // Blend blurred into result where mask is white/opaque
-    for (int y = 0; y < h; ++y) {
-        QRgb *resLine        = reinterpret_cast<QRgb *>(result.scanLine(y));
-        const QRgb *blurLine = reinterpret_cast<const QRgb *>(blurred.constScanLine(y));
-        const QRgb *maskLine = reinterpret_cast<const QRgb *>(maskImg.constScanLine(y));
-
-        for (int x = 0; x < w; ++x) {
-            QRgb m = maskLine[x];
-            if (qAlpha(m) > 0 && qGray(m) > 0) {
-                resLine[x] = blurLine[x];
-            }
-        }
-    }
+    // Blend only around the masked areas, by the mask's coverage; the rest
+    // stays original
+    for (int i = 0; i < regions.rects.size(); ++i)
+        blendByCoverage(result, regions.images[i], m_cumulativeBlurMask, regions.rects[i], m_maskFeather);
 
     m_blurred = QPixmap::fromImage(result);
-    m_cachedBlurStrength = strength;
-    m_cachedBlurredImage = m_blurred;
+    scheduleBlurPrefetch(strength);
 
     emit imagesUpdated(m_original, m_blurred);
 }
@@ -211,10 +254,7 @@ void SessionController::applyFakeBlur(int strength, const QImage &mask)
         return;
     }
 
-    // radius mapping (fast)
-    int radius = static_cast<int>(std::sqrt(strength) * 3.0);
-    if (radius > 30)
-        radius = 30;
+    const int radius = blurRadiusForStrength(strength, m_original.size());
 
     if (radius <= 0) {
         m_blurred = m_original;
@@ -224,51 +264,28 @@ void SessionController::applyFakeBlur(int strength, const QImage &mask)
     }
 
     // Start from the ORIGINAL image
-    QImage base    = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
-    QImage blurred = boxBlur(base, radius);
-    QImage result  = base;
-
-    const int w = result.width();
-    const int h = result.height();
-
-    // Build effective mask: union of cumulative mask and new mask
-    QImage effectiveMask = mask;
-    if (!m_cumulativeBlurMask.isNull() &&
-        m_cumulativeBlurMask.size() == mask.size()) {
-        for (int y = 0; y < h; ++y) {
-            QRgb *maskLine           = reinterpret_cast<QRgb *>(effectiveMask.scanLine(y));
-            const QRgb *cumMaskLine  = reinterpret_cast<const QRgb *>(m_cumulativeBlurMask.constScanLine(y));
-            for (int x = 0; x < w; ++x) {
-                int grayEff = qGray(maskLine[x]);
-                int grayCum = qGray(cumMaskLine[x]);
-                if (grayCum > 0 && grayEff == 0) {
-                    maskLine[x] = cumMaskLine[x];
-                }
-            }
-        }
-    }
+    const QImage base = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage result = base;
 
-    // Blend blurred into result where mask is white
-    for (int y = 0; y < h; ++y) {
-        QRgb *resLine        = reinterpret_cast<QRgb *>(result.scanLine(y));
-        const QRgb *blurLine = reinterpret_cast<const QRgb *>(blurred.constScanLine(y));
-        const QRgb *maskLine = reinterpret_cast<const QRgb *>(effectiveMask.constScanLine(y));
+    // Build effective mask: union of cumulative mask and new mask, the
+    // larger coverage winning along antialiased edges
+    const SoftMask selection = SoftMask::fromImage(mask);
+    SoftMask effectiveMask = selection;
+    effectiveMask |= m_cumulativeBlurMask;
 
-        for (int x = 0; x < w; ++x) {
-            QRgb m = maskLine[x];
-            if (qAlpha(m) > 0 && qGray(m) > 0)
-                resLine[x] = blurLine[x];
-        }
-    }
+    // The union becomes the cumulative mask before blurring, so the regions
+    // are cached (and prefetched) for it
+    setCumulativeMask(effectiveMask);
+    const BlurredRegions regions = blurredRegions(radius);
 
-    m_blurred = QPixmap::fromImage(result);
+    // Blend blurred into result by how much of each pixel the mask covers
+    for (int i = 0; i < regions.rects.size(); ++i)
+        blendByCoverage(result, regions.images[i], effectiveMask, regions.rects[i], m_maskFeather);
 
-    // Invalidate slider cache since mask changed
-    m_cachedBlurStrength = -1;
-    m_cachedBlurredImage = QPixmap();
+    m_blurred = QPixmap::fromImage(result);
+    scheduleBlurPrefetch(strength);
 
-    // Update cumulative blur mask
-    m_cumulativeBlurMask = effectiveMask;
+    recordManualEdit(selection, true);
 
     emit imagesUpdated(m_original, m_blurred);
 }
@@ -281,8 +298,6 @@ void SessionController::adoptComputedFullBlur(const QPixmap &pixmap, int strengt
         return;
 
     m_blurred = pixmap;
-    m_cachedBlurStrength = strength;
-    m_cachedBlurredImage = pixmap;
 
     // If strength <= 0, clear mask, else mark full image as blurred
     // Do NOT overwrite m_cumulativeBlurMask here. keep mask changes tied to explicit selection edits.
@@ -297,60 +312,170 @@ void SessionController::removeBlur(const QImage &mask)
         return;
 
     // Start from original
-    QImage result = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage base = m_original.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage result = base;
 
-    const int w = result.width();
-    const int h = result.height();
+    // What stays blurred: the cumulative mask less the removal mask, in
+    // proportion along its antialiased edge
+    const SoftMask removal = SoftMask::fromImage(mask);
+    SoftMask remaining = m_cumulativeBlurMask;
+    remaining.subtract(removal);
 
-    // Copy blurred pixels EXCEPT where mask is white (those stay original/unblurred)
-    // First, rebuild the result with all currently-blurred areas
+    // Rebuild the result with the areas that stay blurred; the regions of
+    // the current mask cover all of them
     if (!m_cumulativeBlurMask.isNull()) {
-        // Get the blurred version of the entire image
-        int radius = static_cast<int>(std::sqrt(50) * 3.0);  // use midpoint blur for reconstruction
-        if (radius > 30) radius = 30;
-
-        QImage blurredFull = boxBlur(result, radius);
-
-        // Copy blurred where cumulative mask says we should blur, but NOT where removal mask says
-        for (int y = 0; y < h; ++y) {
-            QRgb *resLine        = reinterpret_cast<QRgb *>(result.scanLine(y));
-            const QRgb *blurLine = reinterpret_cast<const QRgb *>(blurredFull.constScanLine(y));
-            const QRgb *cumMaskLine = reinterpret_cast<const QRgb *>(m_cumulativeBlurMask.constScanLine(y));
-            const QRgb *removalMaskLine = reinterpret_cast<const QRgb *>(mask.constScanLine(y));
-
-            for (int x = 0; x < w; ++x) {
-                int grayCum = qGray(cumMaskLine[x]);
-                int grayRem = qGray(removalMaskLine[x]);
-
-                // Blur if in cumulative mask AND NOT in removal mask
-                if (grayCum > 0 && grayRem == 0) {
-                    resLine[x] = blurLine[x];
-                }
-            }
-        }
+        // Blur reconstructed at the midpoint strength
+        const BlurredRegions regions = blurredRegions(blurRadiusForStrength(50, m_original.size()));
+
+        // Blend blurred where the remaining mask covers
+        for (int i = 0; i < regions.rects.size(); ++i)
+            blendByCoverage(result, regions.images[i], remaining, regions.rects[i], m_maskFeather);
     }
 
     m_blurred = QPixmap::fromImage(result);
 
-    // Invalidate cache since we modified the image
-    m_cachedBlurStrength = -1;
-
     // Update cumulative mask: remove the masked area
-    if (!m_cumulativeBlurMask.isNull()) {
-        for (int y = 0; y < h; ++y) {
-            QRgb *cumMaskLine = reinterpret_cast<QRgb *>(m_cumulativeBlurMask.scanLine(y));
-            const QRgb *removalMaskLine = reinterpret_cast<const QRgb *>(mask.constScanLine(y));
-
-            for (int x = 0; x < w; ++x) {
-                int grayRem = qGray(removalMaskLine[x]);
-                if (grayRem > 0) {
-                    cumMaskLine[x] = qRgba(0, 0, 0, 0);  // set to transparent/black
-                }
-            }
+    recordManualEdit(removal, false);
+    setCumulativeMask(remaining);
+}
+
+void SessionController::setBlurCacheLimit(qint64 bytes)
+{
+    QMutexLocker lock(&m_blurCacheMutex);
+    m_blurCache.setMaxCost(qsizetype(std::max<qint64>(bytes / 1024, 1)));
+}
+
+qint64 SessionController::blurCacheLimit() const
+{
+    QMutexLocker lock(&m_blurCacheMutex);
+    return qint64(m_blurCache.maxCost()) * 1024;
+}
+
+void SessionController::setRedactionKernel(const RedactionKernel &kernel)
+{
+    m_redactionKernel = kernel;
+    invalidateBlurCache();
+}
+
+void SessionController::invalidateBlurCache()
+{
+    m_prefetchTimer->stop();
+    m_prefetchCancel = true;
+    ++m_maskGeneration;
+
+    QMutexLocker lock(&m_blurCacheMutex);
+    m_blurCache.clear();
+}
+
+bool SessionController::findCachedBlur(quint64 generation, int radius, BlurredRegions *regions)
+{
+    QMutexLocker lock(&m_blurCacheMutex);
+    const BlurredRegions *cached = m_blurCache.object(blurCacheKey(generation, radius));
+    if (!cached)
+        return false;
+    *regions = *cached;
+    return true;
+}
+
+void SessionController::storeBlur(quint64 generation, int radius, const BlurredRegions &regions)
+{
+    qint64 bytes = 0;
+    for (const QImage &image : regions.images)
+        bytes += image.sizeInBytes();
+
+    // A prefetch that finishes after the mask changed has nothing to add
+    QMutexLocker lock(&m_blurCacheMutex);
+    if (generation == m_maskGeneration)
+        m_blurCache.insert(blurCacheKey(generation, radius), new BlurredRegions(regions),
+                           qsizetype(std::max<qint64>(bytes / 1024, 1)));
+}
+
+SessionController::BlurredRegions SessionController::blurredRegions(int radius)
+{
+    const quint64 generation = m_maskGeneration;
+    BlurredRegions regions;
+    if (findCachedBlur(generation, radius, &regions))
+        return regions;
+
+    // The slider moved past what was prefetched; let the pool threads go
+    m_prefetchCancel = true;
+
+    if (m_maskRectsGeneration != generation) {
+        m_maskRects = maskRegions(m_cumulativeBlurMask.bits());
+        m_maskRectsGeneration = generation;
+    }
+    regions.rects = m_maskRects;
+    for (const QRect &rect : regions.rects)
+        regions.images.push_back(redactRegionAtRadius(*m_blurIntegral, m_redactionKernel, rect, radius));
+
+    storeBlur(generation, radius, regions);
+    return regions;
+}
+
+void SessionController::scheduleBlurPrefetch(int strength)
+{
+    m_prefetchStrength = strength;
+    m_prefetchTimer->start();
+}
+
+// Blurs the radii next to the last one shown, nearest first, on a pool
+// thread. The job stops at the next region once the slider moves on or the
+// mask changes.
+void SessionController::startBlurPrefetch()
+{
+    stopBlurPrefetch();
+    if (!m_blurIntegral || m_maskRectsGeneration != m_maskGeneration)
+        return;
+
+    // The next distinct radii up and down the slider, nearest first
+    const QSize size = m_original.size();
+    const int current = blurRadiusForStrength(m_prefetchStrength, size);
+    QVector<int> up, down;
+    for (int s = m_prefetchStrength + 1; s <= 100 && up.size() < kPrefetchSteps; ++s) {
+        const int radius = blurRadiusForStrength(s, size);
+        if (radius != (up.isEmpty() ? current : up.last()))
+            up.push_back(radius);
+    }
+    for (int s = m_prefetchStrength - 1; s >= 0 && down.size() < kPrefetchSteps; --s) {
+        const int radius = blurRadiusForStrength(s, size);
+        if (radius >= 1 && radius != (down.isEmpty() ? current : down.last()))
+            down.push_back(radius);
+    }
+
+    QVector<int> radii;
+    for (int i = 0; i < kPrefetchSteps; ++i) {
+        for (const QVector<int> *side : { &up, &down }) {
+            BlurredRegions unused;
+            if (i < side->size() && !findCachedBlur(m_maskGeneration, side->at(i), &unused))
+                radii.push_back(side->at(i));
         }
     }
+    if (radii.isEmpty())
+        return;
+
+    m_prefetchCancel = false;
+    m_prefetchJob = QtConcurrent::run([this, integral = m_blurIntegral, kernel = m_redactionKernel,
+                                       rects = m_maskRects,
+                                       generation = quint64(m_maskGeneration), radii] {
+        for (int radius : radii) {
+            BlurredRegions regions;
+            regions.rects = rects;
+            for (const QRect &rect : rects) {
+                if (m_prefetchCancel)
+                    return;
+                regions.images.push_back(redactRegionAtRadius(*integral, kernel, rect, radius));
+            }
+            storeBlur(generation, radius, regions);
+        }
+    });
 }
 
+void SessionController::stopBlurPrefetch()
+{
+    m_prefetchTimer->stop();
+    m_prefetchCancel = true;
+    m_prefetchJob.waitForFinished();
+}
 
 void SessionController::pushState()
 {
@@ -371,9 +496,6 @@ void SessionController::undo()
     // Pop last state from undo stack
     m_blurred = m_undoStack.last();
     m_undoStack.removeLast();
-
-    // Invalidate blur cache since state changed
-    m_cachedBlurStrength = -1;
 }
 
 void SessionController::redo()
@@ -387,163 +509,488 @@ void SessionController::redo()
     // Restore next redo state
     m_blurred = m_redoStack.last();
     m_redoStack.removeLast();
+}
+
+static QString stageName(DetectionStage stage)
+{
+    switch (stage) {
+    case DetectionStage::Preprocess:  return QStringLiteral("preprocess");
+    case DetectionStage::Infer:       return QStringLiteral("infer");
+    case DetectionStage::Postprocess: return QStringLiteral("postprocess");
+    case DetectionStage::Refine:      return QStringLiteral("refine");
+    }
+    return QString();
+}
+
+QFuture<DetectionOutcome> SessionController::detectAsync()
+{
+    return startDetectionJob(QRect());
+}
 
-    // Invalidate blur cache since state changed
-    m_cachedBlurStrength = -1;
+QFuture<DetectionOutcome> SessionController::detectInRegionAsync(const QRect &region)
+{
+    // Some context around the selection, so objects cut by its edge are whole
+    const int margin = qMax(kRegionMinMargin, qMax(region.width(), region.height()) / 6);
+    const QRect padded = region.adjusted(-margin, -margin, margin, margin)
+                             .intersected(QRect(QPoint(0, 0), m_original.size()));
+    return startDetectionJob(padded);
+}
 
+QFuture<DetectionOutcome> SessionController::startDetectionJob(const QRect &region)
+{
+    // A cancelled job can still be inside inference or a worker round-trip.
+    // The new job waits for it on the pool, not here, so only one job ever
+    // uses the detector, gate and cache and the GUI thread never blocks.
+    cancelDetection();
+    const QFuture<DetectionOutcome> previous = m_detectionJob;
+
+    if (!m_sharedImage)
+        m_sharedImage = std::make_shared<SharedImageSlot>();
+
+    // QPixmap must stay on the GUI thread; the job gets a QImage.
+    const QImage image = m_original.toImage();
+    const quint64 generation = m_imageGeneration;
+    const std::shared_ptr<SharedImageSlot> shared = m_sharedImage;
+    JobOptions options;
+    options.tiling = m_tiling;
+    options.adaptive = m_adaptive;
+    options.threshold = m_confidenceThreshold;
+    options.nativeResolution = !region.isEmpty();
+
+    m_detectionJob = QtConcurrent::run(
+        [this, previous, image, generation, shared, options, region](QPromise<DetectionOutcome> &promise) {
+            runDetectionJob(promise, previous, image, *shared, generation, options, region);
+        });
+    return m_detectionJob;
+}
 
+void SessionController::preloadDetector()
+{
+    if (!DetectionEngine::isAvailable())
+        return;
+
+    // A preload for an earlier selection may still be loading; this one
+    // follows it, so the newly selected model is loaded too
+    QFuture<void> previous = m_preloadJob;
+    m_preloadJob = QtConcurrent::run([this, previous]() mutable {
+        previous.waitForFinished();
+        const std::shared_ptr<LoadedModel> model = loadedModel();
+        if (model->native && !model->engine.warmUp())
+            qWarning() << "[SessionController] detector warm-up failed:" << model->engine.lastError();
+        ensureGateLoaded();
+    });
 }
 
-bool SessionController::autoBlurWithPythonDetections(int strength, QString *errorMessage)
+void SessionController::cancelDetection()
 {
-    Q_UNUSED(strength); // detection no longer depends on blur strength
+    if (!m_detectionJob.isFinished())
+        m_detectionJob.cancel();
+}
 
-    if (m_original.isNull()) {
-        if (errorMessage) *errorMessage = "No image loaded in session.";
-        return false;
+void SessionController::runDetectionJob(QPromise<DetectionOutcome> &promise,
+                                        QFuture<DetectionOutcome> previous, const QImage &image,
+                                        SharedImageSlot &shared, quint64 generation,
+                                        const JobOptions &options, const QRect &region)
+{
+    // Each job waits for the one it replaced, which waited for its own
+    previous.waitForFinished();
+    if (promise.isCanceled())
+        return;
+
+    // Progress value is the number of steps entered so far: the three
+    // stages, then one per refinement batch. It never moves back; a tiled
+    // run enters the stages once per batch and the job re-enters
+    // Postprocess to check for a cancel.
+    promise.setProgressRange(0, int(DetectionStage::Refine));
+    int reached = 0;
+    const DetectionProgress progress = [&promise, &reached](const DetectionStep &step) {
+        if (promise.isCanceled())
+            return false;
+        int value = int(step.stage) + 1;
+        QString text = stageName(step.stage);
+        if (step.stage == DetectionStage::Refine) {
+            promise.setProgressRange(0, int(DetectionStage::Refine) + step.count);
+            value = int(DetectionStage::Refine) + step.index + 1;
+            text = QString("%1 %2/%3").arg(text).arg(step.index + 1).arg(step.count);
+        }
+        if (value > reached) {
+            reached = value;
+            promise.setProgressValueAndText(value, text);
+        }
+        return true;
+    };
+
+    DetectionOutcome outcome;
+    outcome.imageGeneration = generation;
+    outcome.region = region;
+
+    if (image.isNull()) {
+        outcome.errorMessage = "No image loaded in session.";
+    } else if (region.isEmpty()) {
+        outcome.ok = detectImage(image, shared, options, outcome, progress);
+    } else {
+        // The crop gets its own shared-memory slot; the full image's stays put.
+        const QImage crop = image.copy(region);
+        SharedImageSlot cropSlot;
+        outcome.ok = detectImage(crop, cropSlot, options, outcome, progress);
+        for (DetectionResult &r : outcome.results)
+            r.box.translate(region.topLeft());
     }
 
-    // If we've already run detection for this image, just re-emit
-    if (m_hasDetectionMask) {
-        emit detectionsUpdated(m_autoBoxes);
-        emit imagesUpdated(m_original, m_blurred); // after image stays whatever it currently is
+    if (promise.isCanceled())
+        return;
+    promise.addResult(outcome);
+}
+
+bool SessionController::detectImage(const QImage &image, SharedImageSlot &shared,
+                                    const JobOptions &options, DetectionOutcome &outcome,
+                                    const DetectionProgress &progress)
+{
+    const TilingOptions &tiling = options.tiling;
+    const AdaptiveOptions &adaptive = options.adaptive;
+    std::vector<DetectionResult> &results = outcome.results;
+    QString *errorMessage = &outcome.errorMessage;
+
+    // Native engine first; the Python worker covers builds without ONNX
+    // Runtime and models that fail to load.
+    const std::shared_ptr<LoadedModel> model = loadedModel();
+    DetectionEngine &engine = model->engine;
+    const bool native = model->native;
+    const bool coarseToFine = native && adaptive.enabled && !options.nativeResolution;
+    const bool tiled = native && !coarseToFine &&
+        (options.nativeResolution || qMax(image.width(), image.height()) >= tiling.minImageSide);
+
+    // Results for these pixels from this model file and these settings
+    // may already be on disk from an earlier session.
+    QByteArray settings;
+    QString modelPath;
+    if (native) {
+        modelPath = model->onnxPath;
+        settings = QString("onnx v=%1 conf=%2 iou=%3").arg(kDetectionCacheFormat)
+                       .arg(engine.confidenceThreshold()).arg(engine.iouThreshold()).toUtf8();
+        if (tiled || coarseToFine) {
+            settings += QString(" tile=%1 overlap=%2 full=%3 merge=%4")
+                            .arg(tiling.tileSize).arg(tiling.overlap)
+                            .arg(int(tiling.includeFullImage)).arg(tiling.mergeThreshold).toUtf8();
+        }
+        if (coarseToFine) {
+            settings += QString(" adaptive below=%1 context=%2 regions=%3 area=%4 merge=%5")
+                            .arg(adaptive.refineBelow).arg(adaptive.context)
+                            .arg(adaptive.maxRegions).arg(adaptive.maxAreaFraction)
+                            .arg(adaptive.mergeThreshold).toUtf8();
+        }
+    } else {
+        modelPath = model->pytorchPath;
+        // The worker is asked for candidates down to kCandidateConfidence
+        settings = QString("python v=%1 conf=%2").arg(kDetectionCacheFormat)
+                       .arg(kCandidateConfidence).toUtf8();
+    }
+    const quint64 imageHash = hashImagePixels(image);
+    const quint64 modelKey = m_detectionCache.modelKey(modelPath, settings);
+
+    if (m_detectionCache.lookup(imageHash, modelKey, &results)) {
+        outcome.fromCache = true;
         return true;
     }
 
-    QDir appDir(QCoreApplication::applicationDirPath()); // .../build/bin/Release
+    // Images the low-resolution pass finds nothing in skip the full run.
+    // Not cached: the verdict depends on the threshold at the time.
+    if (native && !options.nativeResolution && ensureGateLoaded() &&
+        !m_gate.needsFullDetection(image, options.threshold)) {
+        results.clear();
+        outcome.skippedByGate = true;
+        return progress(DetectionStage::Postprocess);
+    }
 
-    QDir rootDir = appDir;
-    rootDir.cdUp(); // Release -> bin
-    rootDir.cdUp(); // bin -> build
-    rootDir.cdUp(); // build -> Project   (repo root)
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = false;
+    if (coarseToFine) {
+        ok = engine.runAdaptiveDetection(image, results, adaptive, tiling, &outcome.metrics, progress);
+        outcome.adaptive = ok;
+    } else if (tiled) {
+        ok = engine.runTiledDetection(image, results, tiling, progress);
+    } else if (native) {
+        std::vector<std::vector<DetectionResult>> batch;
+        ok = engine.runDetectionBatch(&image, 1, batch, progress);
+        if (ok)
+            results = std::move(batch.front());
+    } else {
+        ok = detectWithPython(image, shared, modelPath, results, errorMessage, progress);
+    }
 
-    const QString scriptPath = rootDir.filePath("src/python/liquor_detect.py");
-    const QString modelPath  = rootDir.filePath("models/alcohol-detector.pt");
+    // A cancelled run reports false too; only real failures carry a message.
+    const bool canceled = !progress(DetectionStage::Postprocess);
+    if (native && !ok && !canceled && errorMessage)
+        *errorMessage = engine.lastError();
+    if (ok && !canceled) {
+        m_detectionCache.insert(imageHash, modelKey, results);
+        if (native && !options.nativeResolution)
+            m_gate.recordFullDetection(timer.nsecsElapsed());
+    }
+    return ok;
+}
 
-    if (!QFileInfo::exists(scriptPath)) {
-        if (errorMessage) {
-            *errorMessage = QString("Detection script not found at %1").arg(scriptPath);
-        }
+bool SessionController::applyDetectionOutcome(const DetectionOutcome &outcome, QString *errorMessage)
+{
+    if (m_original.isNull() || outcome.imageGeneration != m_imageGeneration) {
+        if (errorMessage) *errorMessage = "Detection finished for an image that is no longer loaded.";
         return false;
     }
 
-    if (!QFileInfo::exists(modelPath)) {
+    if (!outcome.ok) {
+        if (errorMessage) *errorMessage = outcome.errorMessage;
+        return false;
+    }
+
+    if (outcome.results.empty()) {
         if (errorMessage) {
-            *errorMessage = QString("Model .pt not found at %1").arg(modelPath);
+            if (outcome.skippedByGate)
+                *errorMessage = "The quick pre-check found nothing to blur, so full detection was skipped.";
+            else if (outcome.region.isEmpty())
+                *errorMessage = "Detector returned no boxes. Nothing to blur.";
+            else
+                *errorMessage = "Nothing was found in the selection.";
         }
         return false;
     }
 
-    // Save the current original image to a temporary PNG for Python
-    QTemporaryDir tempDir;
-    if (!tempDir.isValid()) {
-        if (errorMessage) *errorMessage = "Failed to create temporary directory for detector.";
+    if (outcome.region.isEmpty())
+        applyDetections(outcome.results);
+    else
+        mergeRegionDetections(outcome.results);
+    return true;
+}
+
+bool SessionController::runDetection(QString *errorMessage)
+{
+    if (m_original.isNull()) {
+        if (errorMessage) *errorMessage = "No image loaded in session.";
         return false;
     }
 
-    const QString imagePath = tempDir.path() + "/input.png";
-    QImage src = m_original.toImage().convertToFormat(QImage::Format_ARGB32);
-    if (!src.save(imagePath, "PNG")) {
-        if (errorMessage) *errorMessage = "Failed to write temporary PNG for detector.";
+    // If we've already run detection for this image, just re-emit
+    if (m_hasDetectionMask) {
+        emit detectionsUpdated(m_autoBoxes);
+        emit imagesUpdated(m_original, m_blurred);
+        return true;
+    }
+
+    QFuture<DetectionOutcome> job = detectAsync();
+    job.waitForFinished();
+    if (job.isCanceled() || job.resultCount() == 0) {
+        if (errorMessage) *errorMessage = "Detection cancelled.";
         return false;
     }
+    return applyDetectionOutcome(job.result(), errorMessage);
+}
 
-    // Run Python
-    QString pythonExe = "python";
+bool SessionController::selectModel(const QString &name, const QString &precision, QString *errorMessage)
+{
+    const ModelInfo *info = m_catalog.find(name);
+    if (!info) {
+        if (errorMessage) *errorMessage = QString("No model named %1 in model-info.json.").arg(name);
+        return false;
+    }
+    if (!info->variant(precision) && info->pytorchPath.isEmpty()) {
+        if (errorMessage) *errorMessage = QString("%1 has no %2 variant.").arg(name, precision);
+        return false;
+    }
 
-    QStringList args;
-    args << scriptPath
-         << "--image" << imagePath
-         << "--model" << modelPath;
+    {
+        QMutexLocker lock(&m_modelMutex);
+        if (name == m_modelName && precision == m_modelPrecision)
+            return true;
+        m_modelName = name;
+        m_modelPrecision = precision;
+        ++m_modelSelection;
+        m_model.reset();
+    }
 
-    QProcess proc;
-    proc.start(pythonExe, args);
+    // Boxes from the previous model must not answer the next Detect. The
+    // mask and blur they produced stay until that run replaces them.
+    cancelDetection();
+    m_hasDetectionMask = false;
+    m_rawDetections.clear();
+    return true;
+}
 
-    if (!proc.waitForStarted(5000)) {
-        if (errorMessage) {
-            *errorMessage = QString("Failed to start Python (%1): %2")
-                                .arg(pythonExe, proc.errorString());
+QString SessionController::activeModelName() const
+{
+    QMutexLocker lock(&m_modelMutex);
+    return m_modelName;
+}
+
+QString SessionController::activeModelPrecision() const
+{
+    QMutexLocker lock(&m_modelMutex);
+    return m_modelPrecision;
+}
+
+// The load and warm-up run without m_modelMutex, so the GUI thread can read
+// and change the selection meanwhile; the model is published only if the
+// selection it was loaded for is still current.
+std::shared_ptr<SessionController::LoadedModel> SessionController::loadedModel()
+{
+    QMutexLocker loadLock(&m_modelLoadMutex);
+    QString name;
+    QString precision;
+    quint64 selection = 0;
+    {
+        QMutexLocker lock(&m_modelMutex);
+        if (m_model)
+            return m_model;
+        name = m_modelName;
+        precision = m_modelPrecision;
+        selection = m_modelSelection;
+    }
+
+    auto model = std::make_shared<LoadedModel>();
+    model->name = name;
+    model->onnxPath = m_catalog.resolvePath(name, precision);
+    const ModelInfo *info = m_catalog.find(name);
+    if (info)
+        model->pytorchPath = info->pytorchPath;
+
+    if (DetectionEngine::isAvailable() && !model->onnxPath.isEmpty()) {
+        model->engine.setConfidenceThreshold(kCandidateConfidence);
+        model->native = model->engine.loadModel(model->onnxPath);
+        if (!model->native) {
+            qWarning() << "[SessionController] native detector unavailable, using Python:"
+                       << model->engine.lastError();
+        } else if (info && model->engine.inputSize().width() != info->inputSize) {
+            qWarning() << "[SessionController]" << model->onnxPath << "takes"
+                       << model->engine.inputSize() << "but model-info.json says" << info->inputSize;
         }
-        return false;
     }
 
-    if (!proc.waitForFinished(-1)) {
-        if (errorMessage) *errorMessage = "Python detector did not finish.";
+    QMutexLocker lock(&m_modelMutex);
+    if (selection == m_modelSelection)
+        m_model = model;
+    return model;
+}
+
+bool SessionController::ensureGateLoaded()
+{
+    if (!DetectionEngine::isAvailable())
         return false;
+
+    QMutexLocker lock(&m_gateMutex);
+    if (!m_gateLoadAttempted) {
+        m_gateLoadAttempted = true;
+        const GateInfo &info = m_catalog.gate;
+        m_gateEnabled = info.enabled;
+        if (info.enabled) {
+            const QString modelPath = info.modelPath.isEmpty()
+                ? m_catalog.resolvePath(QStringLiteral("fp32")) : info.modelPath;
+            m_gate.setRecallMargin(info.recallMargin);
+            if (!m_gate.load(modelPath, info.inputSize)) {
+                qWarning() << "[SessionController] detection gate disabled:" << m_gate.lastError();
+                m_gateEnabled = false;
+            }
+        }
     }
+    return m_gateEnabled;
+}
 
-    const int exitCode = proc.exitCode();
-    QByteArray rawStdOut = proc.readAllStandardOutput();
-    QByteArray rawStdErr = proc.readAllStandardError();
+bool SessionController::detectWithPython(const QImage &image, SharedImageSlot &shared,
+                                         const QString &modelPath,
+                                         std::vector<DetectionResult> &results, QString *errorMessage,
+                                         const DetectionProgress &progress)
+{
+    const QDir rootDir = projectRootDir();
+    const QString scriptPath = rootDir.filePath("src/python/liquor_detect.py");
 
-    if (exitCode != 0) {
-        QString msg = QString::fromLocal8Bit(rawStdErr.isEmpty() ? rawStdOut : rawStdErr);
+    if (!QFileInfo::exists(scriptPath)) {
         if (errorMessage) {
-            *errorMessage = QString("Python detector failed (exit %1): %2")
-                                .arg(exitCode)
-                                .arg(msg.trimmed());
+            *errorMessage = QString("Detection script not found at %1").arg(scriptPath);
         }
         return false;
     }
 
-    // ---- Parse only last JSON line from stdout ----
-    QByteArray trimmed = rawStdOut.trimmed();
-    int lastNewline = trimmed.lastIndexOf('\n');
-    QByteArray jsonBytes = (lastNewline == -1)
-        ? trimmed
-        : trimmed.mid(lastNewline + 1).trimmed();
-
-    QJsonParseError parseErr;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonBytes, &parseErr);
-    if (parseErr.error != QJsonParseError::NoError || !doc.isObject()) {
+    if (modelPath.isEmpty()) {
         if (errorMessage) {
-            *errorMessage = QString("Failed to parse detector JSON: %1\nRaw stdout:\n%2")
-                                .arg(parseErr.errorString(),
-                                     QString::fromLocal8Bit(trimmed));
+            *errorMessage = "No .pt weights listed for this model in models/model-info.json.";
         }
         return false;
     }
 
-    QJsonObject root = doc.object();
-    QJsonArray dets = root.value("detections").toArray();
-    if (dets.isEmpty()) {
+    if (!QFileInfo::exists(modelPath)) {
         if (errorMessage) {
-            *errorMessage = "Detector returned no boxes. Nothing to blur.";
+            *errorMessage = QString("Model .pt not found at %1").arg(modelPath);
         }
         return false;
     }
 
-    // Build detection rectangles & mask at original image resolution
-    const QSize imgSize = m_original.size();
-    const QRect imgRect(QPoint(0, 0), imgSize);
+    if (!progress(DetectionStage::Preprocess)) {
+        if (errorMessage) *errorMessage = "Detection cancelled.";
+        return false;
+    }
 
-    QImage mask(imgSize, QImage::Format_ARGB32_Premultiplied);
-    mask.fill(Qt::transparent);
+    // Hand the raw pixels over in shared memory; uploaded once per image.
+    QJsonObject request;
+    {
+        QMutexLocker lock(&shared.mutex);
+        if (!shared.uploaded) {
+            if (!shared.buffer.upload(image, errorMessage))
+                return false;
+            shared.uploaded = true;
+        }
 
-    QPainter painter(&mask);
-    painter.setPen(Qt::NoPen);
-    painter.setBrush(Qt::white);
+        request.insert("shm", shared.buffer.name());
+        request.insert("width", shared.buffer.width());
+        request.insert("height", shared.buffer.height());
+        request.insert("stride", shared.buffer.stride());
+        request.insert("format", SharedImageBuffer::pixelFormat());
+    }
+    request.insert("conf", kCandidateConfidence);
 
-    m_autoBoxes.clear();
+    if (!progress(DetectionStage::Infer)) {
+        if (errorMessage) *errorMessage = "Detection cancelled.";
+        return false;
+    }
+
+    // The resident worker keeps the model loaded; it is (re)started on demand.
+    // Its QProcess belongs to the worker thread, so the request runs there.
+    // Re-reporting the current stage is a no-op apart from the cancel check.
+    const auto isCanceled = [&progress]() { return !progress(DetectionStage::Infer); };
+    QJsonObject root;
+    bool ok = false;
+    QMetaObject::invokeMethod(m_detector, [&]() {
+        m_detector->setScriptPath(scriptPath);
+        m_detector->setModelPath(modelPath);
+        ok = m_detector->detect(request, &root, errorMessage, isCanceled);
+    }, Qt::BlockingQueuedConnection);
+
+    if (!ok)
+        return false;
+
+    if (!progress(DetectionStage::Postprocess)) {
+        if (errorMessage) *errorMessage = "Detection cancelled.";
+        return false;
+    }
+
+    QJsonArray dets = root.value("detections").toArray();
+    results.reserve(dets.size());
     for (const QJsonValue &v : dets) {
         QJsonObject o = v.toObject();
-        int x = o.value("x").toInt();
-        int y = o.value("y").toInt();
-        int w = o.value("w").toInt();
-        int h = o.value("h").toInt();
-
-        QRect r(x, y, w, h);
-        r = r.intersected(imgRect);
-        if (!r.isEmpty()) {
-            painter.drawRect(r);
-            m_autoBoxes.push_back(r);
-        }
+        DetectionResult r;
+        r.box = QRect(o.value("x").toInt(), o.value("y").toInt(),
+                      o.value("w").toInt(), o.value("h").toInt());
+        r.confidence = float(o.value("conf").toDouble());
+        r.classId    = o.value("cls").toInt();
+        results.push_back(r);
     }
-    painter.end();
+    return true;
+}
 
-    // Store detection state for this image
-    m_cumulativeBlurMask = mask;
-    m_hasDetectionMask   = true;
+void SessionController::applyDetections(const std::vector<DetectionResult> &results)
+{
+    // Keep every candidate; the threshold only decides which are shown
+    m_rawDetections = results;
+    m_hasDetectionMask = true;
+    rebuildDetectionMask();
 
     // Make sure blurred is still the original (no blur yet)
     m_blurred = m_original;
@@ -551,6 +998,75 @@ bool SessionController::autoBlurWithPythonDetections(int strength, QString *erro
     // Notify UI: outlines + images
     emit detectionsUpdated(m_autoBoxes);
     emit imagesUpdated(m_original, m_blurred);
+}
 
-    return true;
-}
\ No newline at end of file
+void SessionController::mergeRegionDetections(const std::vector<DetectionResult> &results)
+{
+    // Native-resolution boxes join the full-image ones; where both found the
+    // same object, the more confident box stays.
+    m_rawDetections.insert(m_rawDetections.end(), results.begin(), results.end());
+    mergeDetections(m_rawDetections, kRegionMergeOverlap);
+
+    m_hasDetectionMask = true;
+    rebuildDetectionMask();
+
+    emit detectionsUpdated(m_autoBoxes);
+}
+
+void SessionController::setConfidenceThreshold(float conf)
+{
+    m_confidenceThreshold = conf;
+    if (!m_hasDetectionMask || m_original.isNull())
+        return;
+
+    rebuildDetectionMask();
+    emit detectionsUpdated(m_autoBoxes);
+}
+
+void SessionController::rebuildDetectionMask()
+{
+    // Build detection rectangles & mask at original image resolution
+    const QSize imgSize = m_original.size();
+    const QRect imgRect(QPoint(0, 0), imgSize);
+
+    m_autoBoxes.clear();
+    for (const DetectionResult &det : m_rawDetections) {
+        if (det.confidence < m_confidenceThreshold)
+            continue;
+        const QRect r = det.box.intersected(imgRect);
+        if (!r.isEmpty())
+            m_autoBoxes.push_back(r);
+    }
+
+    // Boxes are whole pixels, so they fill words of the mask directly; this
+    // runs on every threshold slider tick
+    SoftMask combined = SoftMask::fromRects(imgSize, m_autoBoxes);
+
+    // Replay manual strokes on top: added areas stay, erased areas stay erased
+    combined |= m_manualAddMask;
+    combined.subtract(m_manualEraseMask);
+
+    setCumulativeMask(combined);
+}
+
+void SessionController::recordManualEdit(const SoftMask &stroke, bool add)
+{
+    const QSize imgSize = m_original.size();
+    if (stroke.size() != imgSize)
+        return;
+
+    SoftMask &setMask   = add ? m_manualAddMask : m_manualEraseMask;
+    SoftMask &clearMask = add ? m_manualEraseMask : m_manualAddMask;
+    if (setMask.size() != imgSize)
+        setMask = SoftMask(imgSize);
+
+    // The most recent stroke wins where strokes overlap
+    setMask |= stroke;
+    clearMask.subtract(stroke);
+}
+
+void SessionController::setCumulativeMask(const SoftMask &mask)
+{
+    m_cumulativeBlurMask = mask;
+    invalidateBlurCache();
+}
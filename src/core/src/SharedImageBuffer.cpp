@@ -0,0 +1,156 @@
+#include "SharedImageBuffer.h"
+
+#include <QCoreApplication>
+#include <QPainter>
+#include <QAtomicInt>
+#include <cstring>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <cerrno>
+#endif
+
+SharedImageBuffer::~SharedImageBuffer()
+{
+    release();
+}
+
+QString SharedImageBuffer::pixelFormat()
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return QStringLiteral("bgra");
+#else
+    return QStringLiteral("argb");
+#endif
+}
+
+bool SharedImageBuffer::upload(const QImage &image, QString *errorMessage)
+{
+    if (image.isNull()) {
+        if (errorMessage) *errorMessage = "No image to share with the detector.";
+        return false;
+    }
+
+    const int w = image.width();
+    const int h = image.height();
+    const int stride = w * 4;
+
+    if (!allocate(qsizetype(stride) * h, errorMessage))
+        return false;
+
+    m_width  = w;
+    m_height = h;
+    m_stride = stride;
+
+    // Write straight into the mapping: plain row copies when the layout
+    // already matches, otherwise let QPainter convert while it draws.
+    if (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32) {
+        for (int y = 0; y < h; ++y)
+            std::memcpy(m_data + qsizetype(y) * stride, image.constScanLine(y), size_t(stride));
+    } else {
+        QImage view(m_data, w, h, stride, QImage::Format_ARGB32);
+        QPainter painter(&view);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(0, 0, image);
+    }
+    return true;
+}
+
+bool SharedImageBuffer::allocate(qsizetype size, QString *errorMessage)
+{
+    if (m_data && m_capacity >= size)
+        return true;
+
+    release();
+
+    static QAtomicInt counter;
+    m_name = QString("cleanshare_%1_%2")
+                 .arg(QCoreApplication::applicationPid())
+                 .arg(counter.fetchAndAddRelaxed(1));
+
+#ifdef _WIN32
+    const quint64 bytes = quint64(size);
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        DWORD(bytes >> 32), DWORD(bytes & 0xffffffffu),
+                                        reinterpret_cast<LPCWSTR>(m_name.utf16()));
+    if (!mapping) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to create shared memory (error %1).").arg(GetLastError());
+        }
+        m_name.clear();
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, SIZE_T(size));
+    if (!view) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to map shared memory (error %1).").arg(GetLastError());
+        }
+        CloseHandle(mapping);
+        m_name.clear();
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<uchar *>(view);
+#else
+    const QByteArray shmName = "/" + m_name.toLatin1();
+    const int fd = shm_open(shmName.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to create shared memory: %1").arg(qt_error_string(errno));
+        }
+        m_name.clear();
+        return false;
+    }
+
+    void *view = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        view = mmap(nullptr, size_t(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd); // the mapping keeps the segment alive
+
+    if (view == MAP_FAILED) {
+        if (errorMessage) {
+            *errorMessage = QString("Failed to map shared memory: %1").arg(qt_error_string(err));
+        }
+        shm_unlink(shmName.constData());
+        m_name.clear();
+        return false;
+    }
+
+    m_data = static_cast<uchar *>(view);
+#endif
+
+    m_capacity = size;
+    return true;
+}
+
+void SharedImageBuffer::release()
+{
+    if (!m_data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    m_mapping = nullptr;
+#else
+    munmap(m_data, size_t(m_capacity));
+    shm_unlink(("/" + m_name.toLatin1()).constData());
+#endif
+
+    m_data = nullptr;
+    m_capacity = 0;
+    m_width = m_height = m_stride = 0;
+    m_name.clear();
+}
@@ -0,0 +1,547 @@
+// DetectionEngine on ONNX Runtime's CPU execution provider.
+// Expects a YOLOv8-style export: input [1, 3, H, W] RGB in [0, 1],
+// output [1, 4 + classes, anchors] with boxes as cx, cy, w, h in input pixels.
+
+#include "DetectionEngine.h"
+#include "Letterbox.h"
+#include "Tiling.h"
+#include "YoloPostprocess.h"
+
+#include <onnxruntime_cxx_api.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+
+namespace {
+
+Ort::Env &ortEnv()
+{
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "CleanShare");
+    return env;
+}
+
+constexpr int   kDefaultInputSize = 640;
+
+// Rough allowance for a forward pass's intermediate activations, as a
+// multiple of its input + output tensors. Errs on the generous side.
+constexpr qint64 kActivationOverhead = 8;
+
+} // namespace
+
+struct DetectionEngine::Impl
+{
+    std::unique_ptr<Ort::Session> session;
+    std::string inputName;
+    std::string outputName;
+    int  inputWidth   = kDefaultInputSize;
+    int  inputHeight  = kDefaultInputSize;
+    bool dynamicBatch = false; // exported with a symbolic batch axis
+    bool dynamicSize  = false; // symbolic H and W: any input size works
+    qint64 outputFloatsPerImage = 0; // 0 when the output shape is symbolic
+
+    QFile  modelFile;               // .ort models: mapped for the session's lifetime
+    uchar *modelData = nullptr;
+
+    ~Impl()
+    {
+        // The session may point into the mapping; drop it first
+        session.reset();
+        releaseModelFile();
+    }
+
+    mutable QMutex errorMutex; // runDetection may fail on several threads at once
+    QString lastError;
+
+    void setError(const QString &message)
+    {
+        QMutexLocker lock(&errorMutex);
+        lastError = message;
+    }
+
+    void releaseModelFile()
+    {
+        if (modelData)
+            modelFile.unmap(modelData);
+        modelData = nullptr;
+        modelFile.close();
+    }
+
+    // Letterbox `images` into one [N, 3, H, W] tensor, run the model once and
+    // decode batch item i into results[i], in that image's pixel coordinates.
+    bool runBatch(const QImage *images, size_t batch,
+                  std::vector<std::vector<DetectionResult>> &results,
+                  float confThreshold, float iouThreshold,
+                  const std::function<bool(DetectionStage)> &enter);
+
+    // Largest batch whose input and output tensors, plus a rough allowance
+    // for intermediate activations, fit in `memoryLimit` bytes. At least 1.
+    size_t maxBatchSize(qint64 memoryLimit) const;
+
+    // What runTiledDetection() runs: the tiles, then the whole frame if asked
+    // for, in batches of tiledBatchSize().
+    std::vector<QRect> tiledRegions(const QSize &imageSize, const TilingOptions &options) const;
+    size_t tiledBatchSize(const TilingOptions &options, qint64 memoryLimit) const;
+};
+
+size_t DetectionEngine::Impl::maxBatchSize(qint64 memoryLimit) const
+{
+    if (!dynamicBatch)
+        return 1;
+
+    const qint64 inputBytes  = qint64(3) * inputWidth * inputHeight * qint64(sizeof(float));
+    const qint64 outputBytes = outputFloatsPerImage * qint64(sizeof(float));
+    const qint64 perImage = (inputBytes + outputBytes) * kActivationOverhead;
+    return size_t(std::max<qint64>(1, memoryLimit / perImage));
+}
+
+std::vector<QRect> DetectionEngine::Impl::tiledRegions(const QSize &imageSize,
+                                                      const TilingOptions &options) const
+{
+    // Tiles are cut at native resolution, so by default a tile is exactly one
+    // model input and small objects keep all their pixels.
+    const int tileSize = options.tileSize > 0 ? options.tileSize : std::max(inputWidth, inputHeight);
+    const QVector<QRect> tiles = computeTiles(imageSize, tileSize, options.overlap);
+
+    std::vector<QRect> regions(tiles.cbegin(), tiles.cend());
+    if (options.includeFullImage && tiles.size() > 1)
+        regions.push_back(QRect(QPoint(0, 0), imageSize)); // large objects that no single tile contains
+    return regions;
+}
+
+size_t DetectionEngine::Impl::tiledBatchSize(const TilingOptions &options, qint64 memoryLimit) const
+{
+    return std::min(size_t(std::max(1, options.batchSize)), maxBatchSize(memoryLimit));
+}
+
+bool DetectionEngine::Impl::runBatch(const QImage *images, size_t batch,
+                                     std::vector<std::vector<DetectionResult>> &results,
+                                     float confThreshold, float iouThreshold,
+                                     const std::function<bool(DetectionStage)> &enter)
+{
+    results.assign(batch, {});
+    if (batch == 0)
+        return true;
+
+    if (!enter(DetectionStage::Preprocess))
+        return false;
+
+    const size_t itemSize = size_t(3) * inputWidth * inputHeight;
+    std::vector<float> tensor(itemSize * batch);
+    std::vector<LetterboxTransform> boxes(batch);
+    for (size_t b = 0; b < batch; ++b)
+        boxes[b] = letterboxToTensor(images[b], inputWidth, inputHeight, tensor.data() + b * itemSize);
+
+    if (!enter(DetectionStage::Infer))
+        return false;
+
+    try {
+        const std::array<int64_t, 4> shape{int64_t(batch), 3, inputHeight, inputWidth};
+        Ort::MemoryInfo memInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
+            memInfo, tensor.data(), tensor.size(), shape.data(), shape.size());
+
+        const char *inputNames[]  = { inputName.c_str() };
+        const char *outputNames[] = { outputName.c_str() };
+
+        std::vector<Ort::Value> outputs = session->Run(
+            Ort::RunOptions{nullptr}, inputNames, &inputTensor, 1, outputNames, 1);
+
+        const std::vector<int64_t> outShape = outputs.front().GetTensorTypeAndShapeInfo().GetShape();
+        if (outShape.size() != 3 || outShape[0] != int64_t(batch)) {
+            setError("Unexpected detector output shape.");
+            return false;
+        }
+
+        // YOLOv8 exports are [N, 4 + classes, anchors]; accept the transposed
+        // layout too, telling them apart by which axis is the short one.
+        const bool channelMajor = outShape[1] < outShape[2];
+        const int channels = int(channelMajor ? outShape[1] : outShape[2]);
+        const int anchors  = int(channelMajor ? outShape[2] : outShape[1]);
+        if (channels < 5) {
+            setError("Detector output has no class scores.");
+            return false;
+        }
+
+        if (!enter(DetectionStage::Postprocess))
+            return false;
+
+        YoloPostprocessOptions post;
+        post.confThreshold = confThreshold;
+        post.iouThreshold  = iouThreshold;
+
+        YoloOutput head;
+        head.channels = channels;
+        head.anchors = anchors;
+        head.channelMajor = channelMajor;
+
+        const float *data = outputs.front().GetTensorData<float>();
+        const size_t outItemSize = size_t(channels) * anchors;
+        for (size_t b = 0; b < batch; ++b) {
+            head.data = data + b * outItemSize;
+            postprocessYolo(head, boxes[b], images[b].size(), post, results[b]);
+        }
+    } catch (const Ort::Exception &e) {
+        setError(QString("ONNX Runtime inference failed: %1").arg(QString::fromUtf8(e.what())));
+        qWarning() << "[DetectionEngine]" << e.what();
+        return false;
+    }
+
+    return true;
+}
+
+DetectionEngine::DetectionEngine()
+    : d(std::make_unique<Impl>())
+{
+}
+
+DetectionEngine::~DetectionEngine() = default;
+
+bool DetectionEngine::isAvailable()
+{
+    return true;
+}
+
+bool DetectionEngine::loadModel(const QString &modelPath)
+{
+    d->session.reset();
+    d->releaseModelFile();
+
+    const QFileInfo info(modelPath);
+    if (!info.exists() || info.size() == 0) {
+        d->setError(QString("Model file missing or empty: %1").arg(modelPath));
+        return false;
+    }
+
+    // ORT-format models run from a mapping of the file kept for as long as
+    // the session: with the options below ORT uses the mapped bytes for the
+    // graph and initializers instead of copying them to the heap. ONNX
+    // protobuf files are always parsed into heap copies, so ORT reads those
+    // from the path and nothing is mapped.
+    const bool ortFormat = info.suffix().compare(QLatin1String("ort"), Qt::CaseInsensitive) == 0;
+    if (ortFormat) {
+        d->modelFile.setFileName(modelPath);
+        if (!d->modelFile.open(QIODevice::ReadOnly)) {
+            d->setError(QString("Cannot open model %1: %2").arg(modelPath, d->modelFile.errorString()));
+            return false;
+        }
+        d->modelData = d->modelFile.map(0, d->modelFile.size());
+        if (!d->modelData) {
+            d->setError(QString("Cannot map model %1: %2").arg(modelPath, d->modelFile.errorString()));
+            d->releaseModelFile();
+            return false;
+        }
+    }
+
+    try {
+        Ort::SessionOptions opts;
+        opts.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+        std::unique_ptr<Ort::Session> session;
+        if (ortFormat) {
+            opts.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+            opts.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+            session = std::make_unique<Ort::Session>(ortEnv(), d->modelData,
+                                                     size_t(d->modelFile.size()), opts);
+        } else {
+#ifdef _WIN32
+            const std::wstring path = QDir::toNativeSeparators(modelPath).toStdWString();
+#else
+            const std::string path = QFile::encodeName(modelPath).toStdString();
+#endif
+            session = std::make_unique<Ort::Session>(ortEnv(), path.c_str(), opts);
+        }
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        d->inputName  = session->GetInputNameAllocated(0, allocator).get();
+        d->outputName = session->GetOutputNameAllocated(0, allocator).get();
+
+        // [N, 3, H, W]; dynamic dimensions come back as -1.
+        const std::vector<int64_t> shape =
+            session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        d->dynamicBatch = shape.size() == 4 && shape[0] <= 0;
+        d->dynamicSize  = shape.size() == 4 && shape[2] <= 0 && shape[3] <= 0;
+        d->inputHeight  = (shape.size() == 4 && shape[2] > 0) ? int(shape[2]) : kDefaultInputSize;
+        d->inputWidth   = (shape.size() == 4 && shape[3] > 0) ? int(shape[3]) : kDefaultInputSize;
+
+        // [N, 4 + classes, anchors]; only used to size batches.
+        const std::vector<int64_t> outShape =
+            session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        d->outputFloatsPerImage = (outShape.size() == 3 && outShape[1] > 0 && outShape[2] > 0)
+                                      ? qint64(outShape[1]) * outShape[2] : 0;
+
+        d->session = std::move(session);
+    } catch (const Ort::Exception &e) {
+        d->setError(QString("ONNX Runtime failed to load %1: %2")
+                        .arg(modelPath, QString::fromUtf8(e.what())));
+        d->releaseModelFile();
+        return false;
+    }
+
+    qDebug() << "[DetectionEngine] loaded" << modelPath
+             << "input" << d->inputWidth << "x" << d->inputHeight
+             << (d->dynamicBatch ? "dynamic batch" : "batch 1");
+    return true;
+}
+
+QSize DetectionEngine::inputSize() const
+{
+    return QSize(d->inputWidth, d->inputHeight);
+}
+
+bool DetectionEngine::setInputSize(int width, int height)
+{
+    if (!d->session || !d->dynamicSize || width <= 0 || height <= 0 ||
+        width % 32 || height % 32) {
+        return false;
+    }
+    d->inputWidth  = width;
+    d->inputHeight = height;
+    return true;
+}
+
+bool DetectionEngine::warmUp()
+{
+    if (!d->session)
+        return false;
+
+    // A mid-grey frame: the first Run() allocates the arena and picks kernels,
+    // whatever the pixels are.
+    QImage frame(d->inputWidth, d->inputHeight, QImage::Format_RGB32);
+    frame.fill(QColor(114, 114, 114));
+
+    std::vector<std::vector<DetectionResult>> ignored;
+    return d->runBatch(&frame, 1, ignored, 1.0f, m_iouThreshold,
+                       [](DetectionStage) { return true; });
+}
+
+bool DetectionEngine::isLoaded() const
+{
+    return d->session != nullptr;
+}
+
+QString DetectionEngine::lastError() const
+{
+    QMutexLocker lock(&d->errorMutex);
+    return d->lastError;
+}
+
+QImage DetectionEngine::runDetection(const QImage &input, std::vector<DetectionResult> &results,
+                                     const DetectionProgress &progress)
+{
+    results.clear();
+    if (!d->session || input.isNull())
+        return input;
+
+    auto enter = [&](DetectionStage stage) { return !progress || progress(stage); };
+
+    std::vector<std::vector<DetectionResult>> batchResults;
+    if (d->runBatch(&input, 1, batchResults, m_confThreshold, m_iouThreshold, enter))
+        results = std::move(batchResults.front());
+
+    return input;
+}
+
+bool DetectionEngine::runDetectionBatch(const QImage *images, size_t count,
+                                        std::vector<std::vector<DetectionResult>> &results,
+                                        const DetectionProgress &progress)
+{
+    results.assign(count, {});
+    if (!d->session) {
+        d->setError("No model loaded.");
+        return false;
+    }
+
+    auto enter = [&](DetectionStage stage) { return !progress || progress(stage); };
+
+    // Null images cannot go through the letterbox; they keep an empty result.
+    std::vector<size_t> valid;
+    valid.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!images[i].isNull())
+            valid.push_back(i);
+    }
+
+    const size_t batchSize = d->maxBatchSize(m_batchMemoryLimit);
+
+    std::vector<QImage> chunk;
+    std::vector<std::vector<DetectionResult>> chunkResults;
+    for (size_t first = 0; first < valid.size(); first += batchSize) {
+        const size_t last = std::min(valid.size(), first + batchSize);
+
+        chunk.clear();
+        for (size_t i = first; i < last; ++i)
+            chunk.push_back(images[valid[i]]);
+
+        if (!d->runBatch(chunk.data(), chunk.size(), chunkResults,
+                         m_confThreshold, m_iouThreshold, enter)) {
+            return false;
+        }
+
+        for (size_t i = first; i < last; ++i)
+            results[valid[i]] = std::move(chunkResults[i - first]);
+    }
+    return true;
+}
+
+bool DetectionEngine::runDetectionBatch(const std::vector<QImage> &images,
+                                        std::vector<std::vector<DetectionResult>> &results,
+                                        const DetectionProgress &progress)
+{
+    return runDetectionBatch(images.data(), images.size(), results, progress);
+}
+
+bool DetectionEngine::runTiledDetection(const QImage &input, std::vector<DetectionResult> &results,
+                                        const TilingOptions &options,
+                                        const DetectionProgress &progress)
+{
+    results.clear();
+    if (!d->session) {
+        d->setError("No model loaded.");
+        return false;
+    }
+    if (input.isNull())
+        return true;
+
+    auto enter = [&](DetectionStage stage) { return !progress || progress(stage); };
+
+    const std::vector<QRect> regions = d->tiledRegions(input.size(), options);
+    const size_t batchSize = d->tiledBatchSize(options, m_batchMemoryLimit);
+
+    std::vector<QImage> crops;
+    std::vector<std::vector<DetectionResult>> batchResults;
+    for (size_t first = 0; first < regions.size(); first += batchSize) {
+        const size_t last = std::min(regions.size(), first + batchSize);
+
+        crops.clear();
+        for (size_t i = first; i < last; ++i)
+            crops.push_back(regions[i] == input.rect() ? input : input.copy(regions[i]));
+
+        if (!d->runBatch(crops.data(), crops.size(), batchResults, m_confThreshold, m_iouThreshold, enter)) {
+            results.clear();
+            return false;
+        }
+
+        for (size_t i = first; i < last; ++i) {
+            const QPoint offset = regions[i].topLeft();
+            for (DetectionResult r : batchResults[i - first]) {
+                r.box.translate(offset);
+                results.push_back(r);
+            }
+        }
+    }
+
+    mergeDetections(results, options.mergeThreshold);
+    return true;
+}
+
+bool DetectionEngine::runAdaptiveDetection(const QImage &input, std::vector<DetectionResult> &results,
+                                           const AdaptiveOptions &options, const TilingOptions &tiling,
+                                           AdaptiveMetrics *metrics, const DetectionProgress &progress)
+{
+    results.clear();
+    AdaptiveMetrics local;
+    AdaptiveMetrics &m = metrics ? *metrics : local;
+    m = AdaptiveMetrics();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::vector<DetectionResult>> coarse;
+    if (!runDetectionBatch(&input, 1, coarse, progress))
+        return false;
+    results = std::move(coarse.front());
+    m.coarseNs = timer.nsecsElapsed();
+    m.coarseCandidates = int(results.size());
+
+    // Nothing was lost to downscaling, so a second look finds nothing new
+    const int inputSide = std::max(d->inputWidth, d->inputHeight);
+    if (input.isNull() || (input.width() <= d->inputWidth && input.height() <= d->inputHeight))
+        return true;
+
+    const std::vector<QRect> regions = refinementRegions(
+        input.size(), results, options.refineBelow, options.context, inputSide, options.maxRegions);
+    if (regions.empty())
+        return true;
+
+    const double imageArea = double(input.width()) * input.height();
+    double regionArea = 0.0;
+    for (const QRect &r : regions)
+        regionArea += double(r.width()) * r.height();
+
+    timer.restart();
+    m.refinedRegions = int(regions.size());
+    m.refinedArea = regionArea / imageArea;
+
+    // Uncertain all over: tiling the whole frame is cheaper than the crops
+    const bool tileAll = m.refinedArea > options.maxAreaFraction;
+
+    // The second pass runs the same stages again, once per batch. Reported
+    // as Refine steps numbered by batch, so progress keeps moving forward.
+    const size_t refineImages = tileAll ? d->tiledRegions(input.size(), tiling).size() : regions.size();
+    const size_t refineBatch = tileAll ? d->tiledBatchSize(tiling, m_batchMemoryLimit)
+                                       : d->maxBatchSize(m_batchMemoryLimit);
+    const int refineBatches = int((refineImages + refineBatch - 1) / refineBatch);
+    int batchesStarted = 0;
+    const DetectionProgress refine = [&](const DetectionStep &step) {
+        if (step.stage == DetectionStage::Preprocess)
+            ++batchesStarted;
+        return !progress
+               || progress(DetectionStep(DetectionStage::Refine,
+                                         std::min(batchesStarted, refineBatches) - 1, refineBatches));
+    };
+
+    if (tileAll) {
+        m.fellBackToTiles = true;
+        m.refinedArea = 1.0;
+        const bool ok = runTiledDetection(input, results, tiling, refine);
+        m.refineNs = timer.nsecsElapsed();
+        return ok;
+    }
+
+    std::vector<QImage> crops;
+    crops.reserve(regions.size());
+    for (const QRect &r : regions)
+        crops.push_back(input.copy(r));
+
+    std::vector<std::vector<DetectionResult>> refined;
+    if (!runDetectionBatch(crops, refined, refine)) {
+        results.clear();
+        return false;
+    }
+
+    // The closer look is authoritative for the weak candidates it covered.
+    auto covered = [&regions](const QRect &box) {
+        for (const QRect &r : regions) {
+            if (r.contains(box))
+                return true;
+        }
+        return false;
+    };
+    results.erase(std::remove_if(results.begin(), results.end(),
+                                 [&](const DetectionResult &r) {
+                                     return r.confidence < options.refineBelow && covered(r.box);
+                                 }),
+                  results.end());
+
+    for (size_t i = 0; i < regions.size(); ++i) {
+        for (DetectionResult r : refined[i]) {
+            r.box.translate(regions[i].topLeft());
+            results.push_back(r);
+        }
+    }
+
+    mergeDetections(results, options.mergeThreshold);
+    m.refineNs = timer.nsecsElapsed();
+    return true;
+}
@@ -5,9 +5,16 @@
 #include <QImage>
 #include <QDebug>
 
+struct DetectionEngine::Impl {};
+
 DetectionEngine::DetectionEngine() = default;
 DetectionEngine::~DetectionEngine() = default;
 
+bool DetectionEngine::isAvailable()
+{
+    return false;
+}
+
 bool DetectionEngine::loadModel(const QString& modelPath)
 {
     Q_UNUSED(modelPath);
@@ -15,10 +22,77 @@ bool DetectionEngine::loadModel(const QString& modelPath)
     return true; // Pretend model loaded to keep flow working
 }
 
-QImage DetectionEngine::runDetection(const QImage& input, std::vector<DetectionResult>& results)
+bool DetectionEngine::isLoaded() const
+{
+    return true;
+}
+
+bool DetectionEngine::warmUp()
+{
+    return true;
+}
+
+QSize DetectionEngine::inputSize() const
+{
+    return QSize();
+}
+
+bool DetectionEngine::setInputSize(int width, int height)
+{
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+    return false;
+}
+
+QString DetectionEngine::lastError() const
+{
+    return QStringLiteral("Built without ONNX Runtime.");
+}
+
+QImage DetectionEngine::runDetection(const QImage& input, std::vector<DetectionResult>& results,
+                                     const DetectionProgress& progress)
 {
+    Q_UNUSED(progress);
     results.clear();
     qDebug() << "[DetectionEngineStub] runDetection called; returning input unchanged.";
     return input; // No overlays or detections
 }
 
+bool DetectionEngine::runTiledDetection(const QImage& input, std::vector<DetectionResult>& results,
+                                        const TilingOptions& options,
+                                        const DetectionProgress& progress)
+{
+    Q_UNUSED(options);
+    runDetection(input, results, progress);
+    return true;
+}
+
+bool DetectionEngine::runAdaptiveDetection(const QImage& input, std::vector<DetectionResult>& results,
+                                           const AdaptiveOptions& options, const TilingOptions& tiling,
+                                           AdaptiveMetrics* metrics,
+                                           const DetectionProgress& progress)
+{
+    Q_UNUSED(options);
+    Q_UNUSED(tiling);
+    if (metrics)
+        *metrics = AdaptiveMetrics();
+    runDetection(input, results, progress);
+    return true;
+}
+
+bool DetectionEngine::runDetectionBatch(const QImage* images, size_t count,
+                                        std::vector<std::vector<DetectionResult>>& results,
+                                        const DetectionProgress& progress)
+{
+    Q_UNUSED(images);
+    Q_UNUSED(progress);
+    results.assign(count, {});
+    return true;
+}
+
+bool DetectionEngine::runDetectionBatch(const std::vector<QImage>& images,
+                                        std::vector<std::vector<DetectionResult>>& results,
+                                        const DetectionProgress& progress)
+{
+    return runDetectionBatch(images.data(), images.size(), results, progress);
+}
@@ -0,0 +1,160 @@
+#ifndef DETECTIONENGINE_H
+#define DETECTIONENGINE_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// One detected object, in pixel coordinates of the image passed in.
+struct DetectionResult
+{
+    QRect box;
+    float confidence = 0.0f;
+    int   classId    = 0;
+};
+
+enum class DetectionStage
+{
+    Preprocess,
+    Infer,
+    Postprocess,
+    Refine       // adaptive runs: the native-resolution pass after the coarse one
+};
+
+// The stage a run has entered. Refine steps are numbered: `index` of `count`
+// inference batches, so the second pass reports forward progress instead of
+// starting the three stages over.
+struct DetectionStep
+{
+    DetectionStep(DetectionStage s, int i = 0, int n = 1) : stage(s), index(i), count(n) {}
+
+    DetectionStage stage;
+    int index;
+    int count;
+};
+
+// Called as each stage starts; returning false abandons the run (cancel).
+using DetectionProgress = std::function<bool(const DetectionStep &)>;
+
+// Sliced inference for high-resolution photos: overlapping tiles cut at
+// native resolution, run through the model in batches, merged with NMS.
+struct TilingOptions
+{
+    int   tileSize       = 0;     // tile edge in image pixels; 0 = model input size
+    float overlap        = 0.2f;  // fraction of a tile shared with its neighbour
+    int   batchSize      = 8;     // tiles per inference call (models with a dynamic batch axis)
+    bool  includeFullImage = true; // also run the downscaled frame, for objects larger than a tile
+    float mergeThreshold = 0.6f;  // cross-tile NMS, overlap measured against the smaller box
+    int   minImageSide   = 1600;  // callers run a single pass below this long side
+};
+
+// Coarse-to-fine detection: one pass over the downscaled frame, then a
+// native-resolution pass over the areas around its uncertain candidates only.
+struct AdaptiveOptions
+{
+    bool  enabled        = false;
+    float refineBelow    = 0.5f;  // coarse candidates under this are looked at again
+    float context        = 1.0f;  // padding around a candidate, in multiples of its size
+    int   maxRegions     = 8;     // refined areas per image, weakest candidates dropped first
+    float maxAreaFraction = 0.5f; // refine at most this share of the image, else tile it all
+    float mergeThreshold = 0.6f;  // NMS across passes, overlap measured against the smaller box
+};
+
+// What one adaptive run did, for the per-image detection metrics.
+struct AdaptiveMetrics
+{
+    int    coarseCandidates = 0;
+    int    refinedRegions   = 0;
+    double refinedArea      = 0.0; // fraction of the image run at native resolution
+    bool   fellBackToTiles  = false;
+    qint64 coarseNs         = 0;
+    qint64 refineNs         = 0;
+};
+
+// In-process YOLO detector on ONNX Runtime's CPU execution provider.
+// Built from DetectionEngineOnnx.cpp when ONNX Runtime is found, otherwise
+// from DetectionEngineStub.cpp, which loads nothing and detects nothing.
+class DetectionEngine
+{
+public:
+    DetectionEngine();
+    ~DetectionEngine();
+
+    DetectionEngine(const DetectionEngine &) = delete;
+    DetectionEngine &operator=(const DetectionEngine &) = delete;
+
+    // False for the stub build; callers should fall back to another detector.
+    static bool isAvailable();
+
+    // Memory-maps the .onnx file and builds the session from the mapping.
+    bool loadModel(const QString &modelPath);
+    bool isLoaded() const;
+
+    // Runs one throwaway inference so the first real call does not pay for
+    // arena allocation and kernel selection.
+    bool warmUp();
+
+    // Model input in pixels. Exports with symbolic H/W can be run at another
+    // size (a multiple of the 32 px stride); fixed-size models refuse.
+    QSize inputSize() const;
+    bool  setInputSize(int width, int height);
+    QString lastError() const;
+
+    // Defaults match liquor_detect.py / ultralytics predict (conf 0.25, iou 0.7).
+    void  setConfidenceThreshold(float conf) { m_confThreshold = conf; }
+    float confidenceThreshold() const        { return m_confThreshold; }
+    void  setIouThreshold(float iou)         { m_iouThreshold = iou; }
+    float iouThreshold() const               { return m_iouThreshold; }
+
+    // Upper bound on the tensor memory of one batched inference call; batches
+    // are split to stay under it. Models with a fixed batch axis always run 1.
+    void   setBatchMemoryLimit(qint64 bytes) { m_batchMemoryLimit = bytes; }
+    qint64 batchMemoryLimit() const          { return m_batchMemoryLimit; }
+
+    // Runs the model on one image. Safe to call from any thread once the
+    // model is loaded. Returns the input unchanged (no overlays are drawn).
+    QImage runDetection(const QImage &input, std::vector<DetectionResult> &results,
+                        const DetectionProgress &progress = {});
+
+    // Sliced variant of runDetection(); boxes are in `input` coordinates.
+    // False if no model is loaded, inference fails or progress cancels.
+    bool runTiledDetection(const QImage &input, std::vector<DetectionResult> &results,
+                           const TilingOptions &options,
+                           const DetectionProgress &progress = {});
+
+    // Coarse pass on the whole frame, then batched native-resolution crops
+    // around candidates below options.refineBelow; coarse candidates inside
+    // a refined area are replaced by what the closer look finds. Images that
+    // already fit the model input get the coarse pass only. If the areas
+    // cover too much of the image, tiling (with `tiling`) is used instead.
+    // The coarse pass reports its stages; the second pass reports Refine.
+    bool runAdaptiveDetection(const QImage &input, std::vector<DetectionResult> &results,
+                              const AdaptiveOptions &options, const TilingOptions &tiling,
+                              AdaptiveMetrics *metrics = nullptr,
+                              const DetectionProgress &progress = {});
+
+    // Runs the model on several images, packed into NCHW batches as large as
+    // the memory limit allows. results[i] belongs to images[i]; null images
+    // get no boxes. False if no model is loaded, inference fails or the
+    // progress callback cancels.
+    bool runDetectionBatch(const QImage *images, size_t count,
+                           std::vector<std::vector<DetectionResult>> &results,
+                           const DetectionProgress &progress = {});
+    bool runDetectionBatch(const std::vector<QImage> &images,
+                           std::vector<std::vector<DetectionResult>> &results,
+                           const DetectionProgress &progress = {});
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> d;
+
+    float m_confThreshold = 0.25f;
+    float m_iouThreshold  = 0.7f;
+    qint64 m_batchMemoryLimit = qint64(512) * 1024 * 1024;
+};
+
+#endif // DETECTIONENGINE_H
@@ -0,0 +1,55 @@
+#ifndef DETECTIONGATE_H
+#define DETECTIONGATE_H
+
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+#include "DetectionEngine.h"
+
+struct GateStats
+{
+    quint64 imagesChecked = 0;
+    quint64 imagesSkipped = 0;      // full detector not run
+    qint64  gateTimeNs    = 0;      // spent in the gate, all images
+    qint64  savedTimeNs   = 0;      // estimated full-detector time avoided, net of gateTimeNs
+};
+
+// Cheap first stage that decides whether an image needs the full detector.
+//
+// Runs a detector at low input resolution (a dedicated small export, or the
+// main model if its H/W are symbolic) and lets an image through when any box
+// scores at least threshold * (1 - recallMargin). A wider margin skips fewer
+// images and misses fewer objects. Errors fail open: the full detector runs.
+// Thread-safe.
+class DetectionGate
+{
+public:
+    DetectionGate() = default;
+
+    bool load(const QString &modelPath, int inputSize);
+    bool isLoaded() const;
+    QString lastError() const { return m_engine.lastError(); }
+
+    void  setRecallMargin(float margin) { m_recallMargin = margin; }
+    float recallMargin() const          { return m_recallMargin; }
+
+    // `threshold` is the confidence the caller will show boxes at.
+    bool needsFullDetection(const QImage &image, float threshold);
+
+    // Wall time of one full detection, for the time-saved estimate.
+    void recordFullDetection(qint64 elapsedNs);
+
+    GateStats stats() const;
+
+private:
+    DetectionEngine m_engine;
+    float m_recallMargin = 0.5f;
+
+    mutable QMutex m_statsMutex;
+    GateStats m_stats;
+    qint64  m_fullTimeNs = 0;
+    quint64 m_fullRuns   = 0;
+};
+
+#endif // DETECTIONGATE_H
@@ -0,0 +1,28 @@
+#ifndef LETTERBOX_H
+#define LETTERBOX_H
+
+#include <QImage>
+
+// How an image was placed into the model input: input = image * scale + pad.
+struct LetterboxTransform
+{
+    float scale = 1.0f;
+    int   padX  = 0;
+    int   padY  = 0;
+};
+
+// ultralytics pad colour (114, 114, 114), normalised.
+constexpr float kLetterboxPadValue = 114.0f / 255.0f;
+
+// Resize `input` to fit dstW x dstH keeping its aspect ratio, centre it on a
+// grey canvas and write planar RGB floats in [0, 1] (3 * dstW * dstH values,
+// NCHW without the batch axis) to `dst`.
+//
+// One fused pass: bilinear sampling with cv2 INTER_LINEAR pixel centres,
+// BGRA -> RGB, normalisation and the planar transpose, SSE2-vectorised and
+// split over output rows on the global thread pool. ARGB32, RGB32 and
+// ARGB32_Premultiplied scanlines are read in place (alpha is ignored);
+// other formats are converted to ARGB32 first.
+LetterboxTransform letterboxToTensor(const QImage &input, int dstW, int dstH, float *dst);
+
+#endif // LETTERBOX_H
@@ -0,0 +1,96 @@
+#ifndef MODELCATALOG_H
+#define MODELCATALOG_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// One exported file of a model at a given precision ("fp32", "int8", ...).
+struct ModelVariant
+{
+    QString precision;
+    QString path;                   // absolute
+    double  expectedLatencyMs = 0;  // one 640 px image on the reference CPU; 0 = unmeasured
+};
+
+struct ModelInfo
+{
+    QString name;
+    QString pytorchPath;            // .pt weights for the Python fallback, may be empty
+    int     inputSize = 640;        // square model input in pixels
+    QStringList classes;            // index = class id
+    QVector<ModelVariant> variants;
+
+    const ModelVariant *variant(const QString &precision) const;
+
+    // Path of the requested precision, or an empty string if not listed.
+    QString variantPath(const QString &precision) const;
+};
+
+// Optional low-resolution first stage (see DetectionGate). Off unless
+// "enabled" is true; without a "model" the default fp32 file is run at
+// `inputSize`, which needs an export with symbolic H/W.
+struct GateInfo
+{
+    bool    enabled      = false;
+    QString modelPath;              // absolute, may be empty
+    int     inputSize    = 320;
+    float   recallMargin = 0.5f;
+};
+
+// Contents of models/model-info.json:
+//
+//   {
+//     "default": "alcohol-detector-v1",
+//     "precision": "fp32",
+//     "models": {
+//       "alcohol-detector-v1": {
+//         "input": 640,
+//         "classes": [ "alcohol" ],
+//         "variants": {
+//           "fp32": { "file": "alcohol-detector-v1.onnx", "latencyMs": 95 },
+//           "int8": "alcohol-detector-v1.int8.onnx"
+//         },
+//         "pytorch": "alcohol-detector-v1.pt"
+//       }
+//     },
+//     "gate": { "enabled": false, "model": "", "input": 320, "recallMargin": 0.5 }
+//   }
+//
+// A variant is either a file name or an object with "file" and "latencyMs".
+// Relative paths are resolved against the directory of the JSON file.
+struct ModelCatalog
+{
+    QString defaultModel;
+    QString defaultPrecision = QStringLiteral("fp32");
+    QVector<ModelInfo> models;
+    GateInfo gate;
+
+    const ModelInfo *find(const QString &name) const;
+    const ModelInfo *defaultInfo() const;
+
+    // Path for `precision` of model `name` (empty: the default model),
+    // falling back to fp32 when that variant is not listed or its file is
+    // missing. Empty if the model is unknown.
+    QString resolvePath(const QString &name, const QString &precision) const;
+    QString resolvePath(const QString &precision) const { return resolvePath(QString(), precision); }
+};
+
+bool loadModelCatalog(const QString &jsonPath, ModelCatalog *catalog, QString *errorMessage = nullptr);
+
+// assets/config/config.json, parsed once and passed to the lookups below.
+// Empty if the file is missing; a parse error is logged and also gives {}.
+QJsonObject loadConfig(const QString &configPath);
+
+// section.key; undefined if unset.
+QJsonValue configValue(const QJsonObject &config, const QString &section, const QString &key);
+
+// "detector": { "precision": "..." }; empty if unset.
+QString configuredPrecision(const QJsonObject &config);
+
+// "detector": { "mode": "fixed" | "adaptive" }; empty if unset.
+QString configuredMode(const QJsonObject &config);
+
+#endif // MODELCATALOG_H
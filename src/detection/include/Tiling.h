@@ -0,0 +1,30 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <vector>
+
+#include "DetectionEngine.h"
+
+// Overlapping tileSize x tileSize tiles covering imageSize. The last tile in
+// each row/column is shifted inward rather than cut short, so every tile is
+// full size whenever the image is at least that large.
+QVector<QRect> computeTiles(const QSize &imageSize, int tileSize, float overlap);
+
+// Greedy class-aware NMS for boxes gathered from several tiles. Overlap is
+// intersection over the smaller box, so the clipped half of an object cut by
+// a tile edge is absorbed by the complete detection from the next tile.
+void mergeDetections(std::vector<DetectionResult> &results, float overlapThreshold);
+
+// Areas of a coarse-to-fine pass worth a second look: every candidate scoring
+// below `refineBelow`, padded by `context` times its size on each side and
+// grown to at least minSide x minSide, with overlapping areas united. When
+// more than maxRegions remain, the weakest candidates' areas are dropped.
+std::vector<QRect> refinementRegions(const QSize &imageSize,
+                                     const std::vector<DetectionResult> &candidates,
+                                     float refineBelow, float context, int minSide,
+                                     int maxRegions);
+
+#endif // TILING_H
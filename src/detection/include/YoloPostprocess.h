@@ -0,0 +1,37 @@
+#ifndef YOLOPOSTPROCESS_H
+#define YOLOPOSTPROCESS_H
+
+#include <QSize>
+#include <vector>
+
+#include "DetectionEngine.h"
+#include "Letterbox.h"
+
+// Raw detection head of a YOLOv8-style model for one image: for every anchor,
+// a box (cx, cy, w, h in model input pixels) followed by one score per class.
+struct YoloOutput
+{
+    const float *data = nullptr;
+    int  channels = 0;          // 4 + number of classes
+    int  anchors  = 0;
+    bool channelMajor = true;   // [channels, anchors] as exported by ultralytics,
+                                // false for the transposed [anchors, channels]
+};
+
+struct YoloPostprocessOptions
+{
+    float confThreshold = 0.25f;
+    float iouThreshold  = 0.7f;
+    int   maxCandidates = 30000; // best-scoring boxes kept for NMS (ultralytics max_nms)
+    int   maxDetections = 300;   // boxes returned (ultralytics max_det)
+};
+
+// Confidence filter, class-aware NMS and mapping back through the letterbox
+// into `imageSize` pixel coordinates. `results` is replaced, most confident
+// first. The score scan is SSE2-vectorised over anchors for the channel-major
+// layout; NMS runs per class on boxes sorted by score.
+void postprocessYolo(const YoloOutput &output, const LetterboxTransform &lb,
+                     const QSize &imageSize, const YoloPostprocessOptions &options,
+                     std::vector<DetectionResult> &results);
+
+#endif // YOLOPOSTPROCESS_H
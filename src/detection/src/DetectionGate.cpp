@@ -0,0 +1,76 @@
+#include "DetectionGate.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <algorithm>
+
+// Everything the gate model scores is returned; the decision is made on the
+// best score, so the caller's threshold can change between images.
+static constexpr float kGateFloor = 0.01f;
+
+bool DetectionGate::load(const QString &modelPath, int inputSize)
+{
+    m_engine.setConfidenceThreshold(kGateFloor);
+    if (!m_engine.loadModel(modelPath))
+        return false;
+
+    if (inputSize > 0 && m_engine.inputSize() != QSize(inputSize, inputSize) &&
+        !m_engine.setInputSize(inputSize, inputSize)) {
+        qWarning() << "[DetectionGate]" << modelPath << "has a fixed input of"
+                   << m_engine.inputSize() << "- the gate saves little at that size";
+    }
+
+    m_engine.warmUp();
+    return true;
+}
+
+bool DetectionGate::isLoaded() const
+{
+    return DetectionEngine::isAvailable() && m_engine.isLoaded();
+}
+
+bool DetectionGate::needsFullDetection(const QImage &image, float threshold)
+{
+    if (!isLoaded())
+        return true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::vector<DetectionResult>> results;
+    const bool ok = m_engine.runDetectionBatch(&image, 1, results);
+
+    float best = 0.0f;
+    if (ok) {
+        for (const DetectionResult &r : results.front())
+            best = std::max(best, r.confidence);
+    }
+    const bool pass = !ok || best >= threshold * (1.0f - m_recallMargin);
+
+    QMutexLocker lock(&m_statsMutex);
+    ++m_stats.imagesChecked;
+    m_stats.gateTimeNs += timer.nsecsElapsed();
+    if (!pass)
+        ++m_stats.imagesSkipped;
+    return pass;
+}
+
+void DetectionGate::recordFullDetection(qint64 elapsedNs)
+{
+    QMutexLocker lock(&m_statsMutex);
+    m_fullTimeNs += elapsedNs;
+    ++m_fullRuns;
+}
+
+GateStats DetectionGate::stats() const
+{
+    QMutexLocker lock(&m_statsMutex);
+    GateStats s = m_stats;
+    if (m_fullRuns > 0) {
+        const qint64 meanFull = m_fullTimeNs / qint64(m_fullRuns);
+        s.savedTimeNs = qint64(s.imagesSkipped) * meanFull - s.gateTimeNs;
+    }
+    return s;
+}
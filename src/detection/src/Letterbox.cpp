@@ -0,0 +1,167 @@
+#include "Letterbox.h"
+
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LETTERBOX_HAVE_SSE2 1
+#endif
+
+namespace {
+
+constexpr int kRowsPerTask = 16;
+
+// Bilinear taps along one axis: output i samples src[i0] and src[i1] with
+// weight w on i1. Pixel centres are aligned, as in cv2.resize.
+struct Taps
+{
+    std::vector<int>   i0;
+    std::vector<int>   i1;
+    std::vector<float> w;
+
+    Taps(int srcLen, int dstLen)
+        : i0(size_t(dstLen)), i1(size_t(dstLen)), w(size_t(dstLen))
+    {
+        const float ratio = float(srcLen) / float(dstLen);
+        for (int i = 0; i < dstLen; ++i) {
+            const float s = std::max(0.0f, (i + 0.5f) * ratio - 0.5f);
+            const int lo = std::min(int(s), srcLen - 1);
+            i0[size_t(i)] = lo;
+            i1[size_t(i)] = std::min(lo + 1, srcLen - 1);
+            w[size_t(i)]  = s - float(lo);
+        }
+    }
+};
+
+#ifdef LETTERBOX_HAVE_SSE2
+template <int Shift>
+inline __m128 channel(__m128i px)
+{
+    return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, Shift), _mm_set1_epi32(0xFF)));
+}
+
+template <int Shift>
+inline __m128 blend(__m128i p00, __m128i p01, __m128i p10, __m128i p11, __m128 wx, __m128 wy)
+{
+    const __m128 a = channel<Shift>(p00), b = channel<Shift>(p01);
+    const __m128 c = channel<Shift>(p10), d = channel<Shift>(p11);
+    const __m128 top    = _mm_add_ps(a, _mm_mul_ps(wx, _mm_sub_ps(b, a)));
+    const __m128 bottom = _mm_add_ps(c, _mm_mul_ps(wx, _mm_sub_ps(d, c)));
+    return _mm_mul_ps(_mm_add_ps(top, _mm_mul_ps(wy, _mm_sub_ps(bottom, top))),
+                      _mm_set1_ps(1.0f / 255.0f));
+}
+#endif
+
+inline float channel(quint32 px, int shift)
+{
+    return float((px >> shift) & 0xFF);
+}
+
+// One output row of the resized image, written to the three planes.
+void resizeRow(const quint32 *row0, const quint32 *row1, float wy, const Taps &tx,
+               int count, float *r, float *g, float *b)
+{
+    const int   *x0 = tx.i0.data();
+    const int   *x1 = tx.i1.data();
+    const float *wx = tx.w.data();
+
+    int x = 0;
+#ifdef LETTERBOX_HAVE_SSE2
+    const __m128 vwy = _mm_set1_ps(wy);
+    for (; x + 4 <= count; x += 4) {
+        const __m128i p00 = _mm_setr_epi32(int(row0[x0[x]]), int(row0[x0[x + 1]]),
+                                           int(row0[x0[x + 2]]), int(row0[x0[x + 3]]));
+        const __m128i p01 = _mm_setr_epi32(int(row0[x1[x]]), int(row0[x1[x + 1]]),
+                                           int(row0[x1[x + 2]]), int(row0[x1[x + 3]]));
+        const __m128i p10 = _mm_setr_epi32(int(row1[x0[x]]), int(row1[x0[x + 1]]),
+                                           int(row1[x0[x + 2]]), int(row1[x0[x + 3]]));
+        const __m128i p11 = _mm_setr_epi32(int(row1[x1[x]]), int(row1[x1[x + 1]]),
+                                           int(row1[x1[x + 2]]), int(row1[x1[x + 3]]));
+        const __m128 vwx = _mm_loadu_ps(wx + x);
+
+        // 0xAARRGGBB: red is bits 16..23, blue bits 0..7
+        _mm_storeu_ps(r + x, blend<16>(p00, p01, p10, p11, vwx, vwy));
+        _mm_storeu_ps(g + x, blend<8>(p00, p01, p10, p11, vwx, vwy));
+        _mm_storeu_ps(b + x, blend<0>(p00, p01, p10, p11, vwx, vwy));
+    }
+#endif
+
+    for (; x < count; ++x) {
+        const quint32 p00 = row0[x0[x]], p01 = row0[x1[x]];
+        const quint32 p10 = row1[x0[x]], p11 = row1[x1[x]];
+        float *planes[3] = { r, g, b };
+        for (int c = 0; c < 3; ++c) {
+            const int shift = 16 - 8 * c;
+            const float top    = channel(p00, shift) + wx[x] * (channel(p01, shift) - channel(p00, shift));
+            const float bottom = channel(p10, shift) + wx[x] * (channel(p11, shift) - channel(p10, shift));
+            planes[c][x] = (top + wy * (bottom - top)) * (1.0f / 255.0f);
+        }
+    }
+}
+
+} // namespace
+
+LetterboxTransform letterboxToTensor(const QImage &input, int dstW, int dstH, float *dst)
+{
+    LetterboxTransform lb;
+    const size_t plane = size_t(dstW) * dstH;
+
+    if (input.isNull() || dstW <= 0 || dstH <= 0) {
+        std::fill(dst, dst + 3 * plane, kLetterboxPadValue);
+        return lb;
+    }
+
+    QImage src = input;
+    if (src.format() != QImage::Format_ARGB32 && src.format() != QImage::Format_RGB32 &&
+        src.format() != QImage::Format_ARGB32_Premultiplied) {
+        src = src.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    lb.scale = std::min(dstW / float(src.width()), dstH / float(src.height()));
+    const int newW = std::clamp(int(std::lround(src.width()  * lb.scale)), 1, dstW);
+    const int newH = std::clamp(int(std::lround(src.height() * lb.scale)), 1, dstH);
+    lb.padX = (dstW - newW) / 2;
+    lb.padY = (dstH - newH) / 2;
+
+    const Taps tx(src.width(), newW);
+    const Taps ty(src.height(), newH);
+
+    std::vector<int> bands;
+    for (int y = 0; y < dstH; y += kRowsPerTask)
+        bands.push_back(y);
+
+    // Each task owns whole output rows in all three planes, padding included,
+    // so every float is written exactly once.
+    QtConcurrent::blockingMap(bands, [&](const int &firstRow) {
+        const int lastRow = std::min(dstH, firstRow + kRowsPerTask);
+        for (int y = firstRow; y < lastRow; ++y) {
+            float *r = dst + size_t(y) * dstW;
+            float *g = r + plane;
+            float *b = g + plane;
+
+            const int sy = y - lb.padY;
+            if (sy < 0 || sy >= newH) {
+                std::fill(r, r + dstW, kLetterboxPadValue);
+                std::fill(g, g + dstW, kLetterboxPadValue);
+                std::fill(b, b + dstW, kLetterboxPadValue);
+                continue;
+            }
+
+            for (float *p : { r, g, b }) {
+                std::fill(p, p + lb.padX, kLetterboxPadValue);
+                std::fill(p + lb.padX + newW, p + dstW, kLetterboxPadValue);
+            }
+
+            const auto *row0 = reinterpret_cast<const quint32 *>(src.constScanLine(ty.i0[size_t(sy)]));
+            const auto *row1 = reinterpret_cast<const quint32 *>(src.constScanLine(ty.i1[size_t(sy)]));
+            resizeRow(row0, row1, ty.w[size_t(sy)], tx, newW,
+                      r + lb.padX, g + lb.padX, b + lb.padX);
+        }
+    });
+
+    return lb;
+}
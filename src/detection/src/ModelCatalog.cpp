@@ -0,0 +1,192 @@
+#include "ModelCatalog.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+// The model shipped with the app, and the name its PyTorch weights had
+// before model-info.json versioned them; installs that still only have the
+// old file keep working with the Python fallback.
+static const char *const kBundledModel = "alcohol-detector-v1";
+static const char *const kLegacyPytorchFile = "alcohol-detector.pt";
+
+static QJsonObject readJsonObject(const QString &path, QString *errorMessage)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = QString("Cannot open %1: %2").arg(path, file.errorString());
+        return {};
+    }
+
+    const QByteArray data = file.readAll();
+    if (data.trimmed().isEmpty())
+        return {}; // an empty file means "use the defaults"
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    if (!doc.isObject()) {
+        if (errorMessage) {
+            *errorMessage = QString("Invalid JSON in %1: %2").arg(path, parseError.errorString());
+        }
+        return {};
+    }
+    return doc.object();
+}
+
+const ModelVariant *ModelInfo::variant(const QString &precision) const
+{
+    for (const ModelVariant &v : variants) {
+        if (v.precision.compare(precision, Qt::CaseInsensitive) == 0)
+            return &v;
+    }
+    return nullptr;
+}
+
+QString ModelInfo::variantPath(const QString &precision) const
+{
+    const ModelVariant *v = variant(precision);
+    return v ? v->path : QString();
+}
+
+const ModelInfo *ModelCatalog::find(const QString &name) const
+{
+    for (const ModelInfo &info : models) {
+        if (info.name == name)
+            return &info;
+    }
+    return nullptr;
+}
+
+const ModelInfo *ModelCatalog::defaultInfo() const
+{
+    if (const ModelInfo *info = find(defaultModel))
+        return info;
+    return models.isEmpty() ? nullptr : &models.front();
+}
+
+QString ModelCatalog::resolvePath(const QString &name, const QString &precision) const
+{
+    const ModelInfo *info = name.isEmpty() ? defaultInfo() : find(name);
+    if (!info)
+        return {};
+
+    const QString wanted = precision.isEmpty() ? defaultPrecision : precision;
+    const QString path = info->variantPath(wanted);
+    if (!path.isEmpty() && QFileInfo::exists(path))
+        return path;
+
+    if (wanted.compare(QLatin1String("fp32"), Qt::CaseInsensitive) != 0) {
+        qWarning() << "[ModelCatalog]" << wanted << "variant of" << info->name
+                   << "not available, using fp32";
+    }
+    return info->variantPath(QStringLiteral("fp32"));
+}
+
+bool loadModelCatalog(const QString &jsonPath, ModelCatalog *catalog, QString *errorMessage)
+{
+    *catalog = ModelCatalog();
+
+    QString readError;
+    const QJsonObject root = readJsonObject(jsonPath, &readError);
+    if (!readError.isEmpty()) {
+        if (errorMessage) *errorMessage = readError;
+        return false;
+    }
+
+    const QDir baseDir = QFileInfo(jsonPath).absoluteDir();
+    auto resolve = [&baseDir](const QString &p) {
+        return p.isEmpty() ? QString() : QDir::cleanPath(baseDir.absoluteFilePath(p));
+    };
+
+    catalog->defaultModel = root.value("default").toString();
+    catalog->defaultPrecision = root.value("precision").toString(QStringLiteral("fp32"));
+
+    const QJsonObject models = root.value("models").toObject();
+    for (auto it = models.constBegin(); it != models.constEnd(); ++it) {
+        const QJsonObject entry = it.value().toObject();
+
+        ModelInfo info;
+        info.name = it.key();
+        info.pytorchPath = resolve(entry.value("pytorch").toString());
+        info.inputSize = entry.value("input").toInt(info.inputSize);
+        for (const QJsonValue &c : entry.value("classes").toArray())
+            info.classes << c.toString();
+
+        const QJsonObject variants = entry.value("variants").toObject();
+        for (auto v = variants.constBegin(); v != variants.constEnd(); ++v) {
+            ModelVariant variant;
+            variant.precision = v.key();
+            if (v.value().isObject()) {
+                const QJsonObject spec = v.value().toObject();
+                variant.path = resolve(spec.value("file").toString());
+                variant.expectedLatencyMs = spec.value("latencyMs").toDouble();
+            } else {
+                variant.path = resolve(v.value().toString());
+            }
+            info.variants.push_back(variant);
+        }
+
+        catalog->models.push_back(info);
+    }
+
+    const QJsonObject gate = root.value("gate").toObject();
+    catalog->gate.enabled      = gate.value("enabled").toBool(false);
+    catalog->gate.modelPath    = resolve(gate.value("model").toString());
+    catalog->gate.inputSize    = gate.value("input").toInt(catalog->gate.inputSize);
+    catalog->gate.recallMargin = float(gate.value("recallMargin").toDouble(catalog->gate.recallMargin));
+
+    // Older checkouts ship an empty model-info.json; describe the bundled model.
+    if (catalog->models.isEmpty()) {
+        ModelInfo info;
+        info.name = QLatin1String(kBundledModel);
+        info.pytorchPath = resolve(QStringLiteral("alcohol-detector-v1.pt"));
+        info.classes << QStringLiteral("alcohol");
+        info.variants.push_back({ QStringLiteral("fp32"), resolve(QStringLiteral("alcohol-detector-v1.onnx")) });
+        info.variants.push_back({ QStringLiteral("int8"), resolve(QStringLiteral("alcohol-detector-v1.int8.onnx")) });
+        catalog->models.push_back(info);
+    }
+    if (catalog->defaultModel.isEmpty())
+        catalog->defaultModel = catalog->models.front().name;
+
+    const QString legacyPytorch = resolve(QLatin1String(kLegacyPytorchFile));
+    for (ModelInfo &info : catalog->models) {
+        if (info.name == QLatin1String(kBundledModel) && !QFileInfo::exists(info.pytorchPath)
+            && QFileInfo::exists(legacyPytorch)) {
+            qWarning() << "[ModelCatalog]" << info.pytorchPath << "not found, using" << legacyPytorch;
+            info.pytorchPath = legacyPytorch;
+        }
+    }
+
+    return true;
+}
+
+QJsonObject loadConfig(const QString &configPath)
+{
+    if (!QFileInfo::exists(configPath))
+        return {};
+
+    QString readError;
+    const QJsonObject root = readJsonObject(configPath, &readError);
+    if (!readError.isEmpty())
+        qWarning() << "[ModelCatalog]" << readError;
+    return root;
+}
+
+QJsonValue configValue(const QJsonObject &config, const QString &section, const QString &key)
+{
+    return config.value(section).toObject().value(key);
+}
+
+QString configuredPrecision(const QJsonObject &config)
+{
+    return configValue(config, QStringLiteral("detector"), QStringLiteral("precision")).toString();
+}
+
+QString configuredMode(const QJsonObject &config)
+{
+    return configValue(config, QStringLiteral("detector"), QStringLiteral("mode")).toString();
+}
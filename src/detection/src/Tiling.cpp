@@ -0,0 +1,143 @@
+#include "Tiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+static QVector<int> tileOrigins(int length, int tile, int stride)
+{
+    QVector<int> origins;
+    if (length <= tile) {
+        origins.push_back(0);
+        return origins;
+    }
+
+    for (int p = 0; ; p += stride) {
+        if (p + tile >= length) {
+            origins.push_back(length - tile);
+            break;
+        }
+        origins.push_back(p);
+    }
+    return origins;
+}
+
+QVector<QRect> computeTiles(const QSize &imageSize, int tileSize, float overlap)
+{
+    QVector<QRect> tiles;
+    if (imageSize.isEmpty() || tileSize <= 0)
+        return tiles;
+
+    overlap = std::clamp(overlap, 0.0f, 0.9f);
+    const int stride = std::max(1, int(std::lround(tileSize * (1.0f - overlap))));
+
+    const QVector<int> xs = tileOrigins(imageSize.width(), tileSize, stride);
+    const QVector<int> ys = tileOrigins(imageSize.height(), tileSize, stride);
+    const QRect bounds(QPoint(0, 0), imageSize);
+
+    tiles.reserve(xs.size() * ys.size());
+    for (int y : ys) {
+        for (int x : xs)
+            tiles.push_back(QRect(x, y, tileSize, tileSize).intersected(bounds));
+    }
+    return tiles;
+}
+
+static QRect grownTo(const QRect &r, int minSide, const QRect &bounds)
+{
+    QRect grown = r;
+    if (grown.width() < minSide) {
+        const int dx = minSide - grown.width();
+        grown.adjust(-dx / 2, 0, dx - dx / 2, 0);
+    }
+    if (grown.height() < minSide) {
+        const int dy = minSide - grown.height();
+        grown.adjust(0, -dy / 2, 0, dy - dy / 2);
+    }
+
+    // Slide back inside rather than clip, so the crop keeps its size.
+    if (grown.width() <= bounds.width())
+        grown.moveLeft(std::clamp(grown.left(), bounds.left(), bounds.right() - grown.width() + 1));
+    if (grown.height() <= bounds.height())
+        grown.moveTop(std::clamp(grown.top(), bounds.top(), bounds.bottom() - grown.height() + 1));
+    return grown.intersected(bounds);
+}
+
+std::vector<QRect> refinementRegions(const QSize &imageSize,
+                                     const std::vector<DetectionResult> &candidates,
+                                     float refineBelow, float context, int minSide,
+                                     int maxRegions)
+{
+    std::vector<const DetectionResult *> weak;
+    for (const DetectionResult &c : candidates) {
+        if (c.confidence < refineBelow && !c.box.isEmpty())
+            weak.push_back(&c);
+    }
+    std::sort(weak.begin(), weak.end(),
+              [](const DetectionResult *a, const DetectionResult *b) {
+                  return a->confidence > b->confidence;
+              });
+
+    const QRect bounds(QPoint(0, 0), imageSize);
+    std::vector<QRect> regions;
+    for (const DetectionResult *c : weak) {
+        if (int(regions.size()) >= maxRegions)
+            break;
+
+        const int padX = int(std::lround(c->box.width() * context));
+        const int padY = int(std::lround(c->box.height() * context));
+        QRect region = grownTo(c->box.adjusted(-padX, -padY, padX, padY), minSide, bounds);
+
+        // Unite with whatever it touches; the union may touch more.
+        for (bool merged = true; merged; ) {
+            merged = false;
+            for (size_t i = 0; i < regions.size(); ++i) {
+                if (regions[i].intersects(region)) {
+                    region |= regions[i];
+                    regions.erase(regions.begin() + std::ptrdiff_t(i));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+void mergeDetections(std::vector<DetectionResult> &results, float overlapThreshold)
+{
+    std::sort(results.begin(), results.end(),
+              [](const DetectionResult &a, const DetectionResult &b) {
+                  return a.confidence > b.confidence;
+              });
+
+    std::vector<DetectionResult> kept;
+    kept.reserve(results.size());
+
+    for (const DetectionResult &r : results) {
+        const qint64 area = qint64(r.box.width()) * r.box.height();
+        bool duplicate = false;
+
+        for (const DetectionResult &k : kept) {
+            if (k.classId != r.classId)
+                continue;
+
+            const QRect inter = k.box.intersected(r.box);
+            if (inter.isEmpty())
+                continue;
+
+            const qint64 smaller = std::min(area, qint64(k.box.width()) * k.box.height());
+            const qint64 overlapArea = qint64(inter.width()) * inter.height();
+            if (smaller > 0 && overlapArea >= overlapThreshold * smaller) {
+                duplicate = true;
+                break;
+            }
+        }
+
+        if (!duplicate)
+            kept.push_back(r);
+    }
+
+    results.swap(kept);
+}
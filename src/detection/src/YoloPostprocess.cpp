@@ -0,0 +1,191 @@
+#include "YoloPostprocess.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define YOLO_HAVE_SSE2 1
+#endif
+
+namespace {
+
+struct Candidate
+{
+    int   anchor;
+    int   classId;
+    float score;
+};
+
+struct Box
+{
+    float x1, y1, x2, y2;
+    float area;
+};
+
+// Best class and score for every anchor at or above `threshold`.
+void scanChannelMajor(const float *out, int channels, int anchors, float threshold,
+                      std::vector<Candidate> &candidates)
+{
+    const int numClasses = channels - 4;
+    const float *scores = out + size_t(4) * anchors;
+
+    int i = 0;
+#ifdef YOLO_HAVE_SSE2
+    // Four anchors at a time: running max and argmax down the class rows,
+    // which are contiguous in this layout.
+    const __m128 vthreshold = _mm_set1_ps(threshold);
+    for (; i + 4 <= anchors; i += 4) {
+        __m128  best  = _mm_loadu_ps(scores + i);
+        __m128i bestC = _mm_setzero_si128();
+        for (int c = 1; c < numClasses; ++c) {
+            const __m128 s = _mm_loadu_ps(scores + size_t(c) * anchors + i);
+            const __m128 gt = _mm_cmpgt_ps(s, best);
+            best  = _mm_max_ps(s, best);
+            bestC = _mm_or_si128(_mm_and_si128(_mm_castps_si128(gt), _mm_set1_epi32(c)),
+                                 _mm_andnot_si128(_mm_castps_si128(gt), bestC));
+        }
+
+        int keep = _mm_movemask_ps(_mm_cmpge_ps(best, vthreshold));
+        if (!keep)
+            continue;
+
+        alignas(16) float bestScores[4];
+        alignas(16) int   bestClasses[4];
+        _mm_store_ps(bestScores, best);
+        _mm_store_si128(reinterpret_cast<__m128i *>(bestClasses), bestC);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (keep & (1 << lane))
+                candidates.push_back({ i + lane, bestClasses[lane], bestScores[lane] });
+        }
+    }
+#endif
+
+    for (; i < anchors; ++i) {
+        int bestClass = 0;
+        float best = scores[i];
+        for (int c = 1; c < numClasses; ++c) {
+            const float s = scores[size_t(c) * anchors + i];
+            if (s > best) {
+                best = s;
+                bestClass = c;
+            }
+        }
+        if (best >= threshold)
+            candidates.push_back({ i, bestClass, best });
+    }
+}
+
+void scanAnchorMajor(const float *out, int channels, int anchors, float threshold,
+                     std::vector<Candidate> &candidates)
+{
+    for (int i = 0; i < anchors; ++i) {
+        const float *scores = out + size_t(i) * channels + 4;
+        const float *best = std::max_element(scores, scores + (channels - 4));
+        if (*best >= threshold)
+            candidates.push_back({ i, int(best - scores), *best });
+    }
+}
+
+inline float iou(const Box &a, const Box &b)
+{
+    const float ix = std::max(0.0f, std::min(a.x2, b.x2) - std::max(a.x1, b.x1));
+    const float iy = std::max(0.0f, std::min(a.y2, b.y2) - std::max(a.y1, b.y1));
+    const float inter = ix * iy;
+    const float uni = a.area + b.area - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+} // namespace
+
+void postprocessYolo(const YoloOutput &output, const LetterboxTransform &lb,
+                     const QSize &imageSize, const YoloPostprocessOptions &options,
+                     std::vector<DetectionResult> &results)
+{
+    results.clear();
+    if (!output.data || output.channels < 5 || output.anchors <= 0 || lb.scale <= 0.0f)
+        return;
+
+    std::vector<Candidate> candidates;
+    if (output.channelMajor)
+        scanChannelMajor(output.data, output.channels, output.anchors, options.confThreshold, candidates);
+    else
+        scanAnchorMajor(output.data, output.channels, output.anchors, options.confThreshold, candidates);
+
+    if (candidates.empty())
+        return;
+
+    // Keep the best maxCandidates, then group by class, best first in each.
+    auto byScore = [](const Candidate &a, const Candidate &b) { return a.score > b.score; };
+    if (options.maxCandidates > 0 && candidates.size() > size_t(options.maxCandidates)) {
+        std::nth_element(candidates.begin(), candidates.begin() + options.maxCandidates,
+                         candidates.end(), byScore);
+        candidates.resize(size_t(options.maxCandidates));
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.classId != b.classId ? a.classId < b.classId : a.score > b.score;
+    });
+
+    // Decode boxes only for the survivors, straight into image pixels.
+    const float w = float(imageSize.width());
+    const float h = float(imageSize.height());
+    const float inv = 1.0f / lb.scale;
+    std::vector<Box> boxes(candidates.size());
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        const int i = candidates[k].anchor;
+        float cx, cy, bw, bh;
+        if (output.channelMajor) {
+            const size_t n = size_t(output.anchors);
+            cx = output.data[i]; cy = output.data[n + i];
+            bw = output.data[2 * n + i]; bh = output.data[3 * n + i];
+        } else {
+            const float *a = output.data + size_t(i) * output.channels;
+            cx = a[0]; cy = a[1]; bw = a[2]; bh = a[3];
+        }
+
+        Box &b = boxes[k];
+        b.x1 = std::clamp((cx - bw / 2 - lb.padX) * inv, 0.0f, w);
+        b.y1 = std::clamp((cy - bh / 2 - lb.padY) * inv, 0.0f, h);
+        b.x2 = std::clamp((cx + bw / 2 - lb.padX) * inv, 0.0f, w);
+        b.y2 = std::clamp((cy + bh / 2 - lb.padY) * inv, 0.0f, h);
+        b.area = (b.x2 - b.x1) * (b.y2 - b.y1);
+    }
+
+    // Greedy NMS inside each class run; boxes never compare across classes.
+    std::vector<char> suppressed(candidates.size(), 0);
+    std::vector<size_t> kept;
+    for (size_t begin = 0; begin < candidates.size();) {
+        size_t end = begin;
+        while (end < candidates.size() && candidates[end].classId == candidates[begin].classId)
+            ++end;
+
+        for (size_t i = begin; i < end; ++i) {
+            if (suppressed[i])
+                continue;
+            kept.push_back(i);
+            for (size_t j = i + 1; j < end; ++j) {
+                if (!suppressed[j] && iou(boxes[i], boxes[j]) > options.iouThreshold)
+                    suppressed[j] = 1;
+            }
+        }
+        begin = end;
+    }
+
+    std::sort(kept.begin(), kept.end(), [&candidates](size_t a, size_t b) {
+        return candidates[a].score > candidates[b].score;
+    });
+    if (options.maxDetections > 0 && kept.size() > size_t(options.maxDetections))
+        kept.resize(size_t(options.maxDetections));
+
+    results.reserve(kept.size());
+    for (size_t k : kept) {
+        const Box &b = boxes[k];
+        DetectionResult r;
+        r.box = QRect(int(std::lround(b.x1)), int(std::lround(b.y1)),
+                      int(std::lround(b.x2 - b.x1)), int(std::lround(b.y2 - b.y1)));
+        r.confidence = candidates[k].score;
+        r.classId = candidates[k].classId;
+        results.push_back(r);
+    }
+}
@@ -0,0 +1,242 @@
+// Scaling of the redaction kernels with thread count: whole-image box blur
+// and the masked-region blur the session runs, from 1 thread up to --threads.
+// Every thread count must produce the same pixels as the single-thread run.
+// Then the per-strength cost of the masked blur with and without a cached
+// BlurIntegral, which must match running sums exactly, and of strong blurs
+// at full and at reduced resolution.
+//
+//   cleanshare_blur_benchmark
+//   cleanshare_blur_benchmark --size 8000x6000 --radius 21 --coverage 0.1 --threads 16
+//   cleanshare_blur_benchmark --runs 5 photo.jpg
+
+#include "BandParallel.h"
+#include "BlurIntegral.h"
+#include "BoxBlur.h"
+#include "MaskRegions.h"
+#include "ScaledBlur.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace {
+
+double medianMs(int runs, const std::function<void()> &fn)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        times.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Noise, so the blur cannot be shortcut by flat areas.
+QImage syntheticImage(int w, int h)
+{
+    QImage image(w, h, QImage::Format_ARGB32_Premultiplied);
+    QRandomGenerator rng(42);
+    for (int y = 0; y < h; ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(image.scanLine(y));
+        for (int x = 0; x < w; ++x)
+            line[x] = rng.generate() | 0xFF000000u;
+    }
+    return image;
+}
+
+// Scattered rectangles covering roughly `coverage` of the frame, like a
+// handful of detections.
+QImage syntheticMask(const QSize &size, double coverage)
+{
+    QImage mask(size, QImage::Format_ARGB32_Premultiplied);
+    mask.fill(Qt::transparent);
+
+    QPainter p(&mask);
+    QRandomGenerator rng(7);
+    const int boxes = 12;
+    const double side = std::sqrt(coverage * size.width() * size.height() / boxes);
+    for (int i = 0; i < boxes; ++i) {
+        const int bw = std::max(1, int(side * (0.5 + rng.generateDouble())));
+        const int bh = std::max(1, int(side * side / bw));
+        p.fillRect(rng.bounded(std::max(1, size.width() - bw)),
+                   rng.bounded(std::max(1, size.height() - bh)), bw, bh, Qt::white);
+    }
+    return mask;
+}
+
+QImage regionBlur(const QImage &image, const QVector<QRect> &regions, int radius)
+{
+    QImage result = image;
+    QPainter p(&result);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    for (const QRect &rect : regions)
+        p.drawImage(rect.topLeft(), boxBlurRegion(image, rect, radius));
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cleanshare_blur_benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Time the blur kernels at 1..N threads.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("image", "Photo to blur; a noise image if omitted.", "[image]");
+
+    const QCommandLineOption sizeOpt("size", "Synthetic image size.", "WxH", "8000x6000");
+    const QCommandLineOption radiusOpt("radius", "Blur radius in pixels.", "px", "21");
+    const QCommandLineOption coverageOpt("coverage", "Masked share of the image.", "fraction", "0.05");
+    const QCommandLineOption threadsOpt("threads", "Highest thread count to try.", "n",
+                                        QString::number(QThread::idealThreadCount()));
+    const QCommandLineOption runsOpt("runs", "Timed runs per setting (median is reported).", "n", "3");
+    parser.addOptions({ sizeOpt, radiusOpt, coverageOpt, threadsOpt, runsOpt });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QImage image;
+    if (!parser.positionalArguments().isEmpty()) {
+        image = QImage(parser.positionalArguments().front());
+        if (image.isNull()) {
+            err << "Cannot read " << parser.positionalArguments().front() << "\n";
+            return 1;
+        }
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    } else {
+        const QStringList wh = parser.value(sizeOpt).split('x');
+        const int w = wh.value(0).toInt();
+        const int h = wh.value(1).toInt();
+        if (w <= 0 || h <= 0) {
+            err << "Bad --size, expected WxH.\n";
+            return 1;
+        }
+        image = syntheticImage(w, h);
+    }
+
+    const int radius = std::max(1, parser.value(radiusOpt).toInt());
+    const int maxThreads = std::max(1, parser.value(threadsOpt).toInt());
+    const int runs = std::max(1, parser.value(runsOpt).toInt());
+    const QVector<QRect> regions =
+        maskRegions(syntheticMask(image.size(), parser.value(coverageOpt).toDouble()));
+
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    out << image.width() << "x" << image.height() << ", radius " << radius << ", "
+        << regions.size() << " mask regions, " << runs << " runs each\n\n";
+    out << QString("%1 %2 %3 %4 %5")
+               .arg(QStringLiteral("threads"), 7).arg(QStringLiteral("full ms"), 10)
+               .arg(QStringLiteral("speedup"), 8).arg(QStringLiteral("masked ms"), 10)
+               .arg(QStringLiteral("speedup"), 8) << "\n";
+
+    QImage referenceFull, referenceMasked;
+    double baseFull = 0.0, baseMasked = 0.0;
+    bool identical = true;
+
+    for (int threads : counts) {
+        setRedactionThreadCount(threads);
+
+        QImage full, masked;
+        const double fullMs = medianMs(runs, [&] { full = boxBlur(image, radius); });
+        const double maskedMs = medianMs(runs, [&] { masked = regionBlur(image, regions, radius); });
+
+        if (threads == 1) {
+            referenceFull = full;
+            referenceMasked = masked;
+            baseFull = fullMs;
+            baseMasked = maskedMs;
+        } else if (full != referenceFull || masked != referenceMasked) {
+            identical = false;
+        }
+
+        out << QString("%1 %2 %3 %4 %5")
+                   .arg(threads, 7)
+                   .arg(fullMs, 10, 'f', 1).arg(baseFull / fullMs, 7, 'f', 2)
+                   .arg(maskedMs, 11, 'f', 1).arg(baseMasked / maskedMs, 7, 'f', 2)
+            << "x\n";
+        out.flush();
+    }
+
+    if (!identical) {
+        err << "\nOutput differs between thread counts.\n";
+        return 1;
+    }
+    out << "\nOutput identical at every thread count.\n";
+
+    // Slider moves: the masked-region blur at several strengths, running sums
+    // against sampling a BlurIntegral that is built once for the image.
+    setRedactionThreadCount(maxThreads);
+    BlurIntegral integral(image);
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    for (const QRect &rect : regions)
+        integral.blurRegion(rect, 30); // tiles for the largest radius below
+    out << "\nTable build for the masked regions: " << QString::number(buildTimer.nsecsElapsed() / 1.0e6, 'f', 1)
+        << " ms, " << QString::number(integral.memoryUsage() / (1024.0 * 1024.0), 'f', 1) << " MB\n";
+
+    out << QString("%1 %2 %3").arg(QStringLiteral("radius"), 7)
+               .arg(QStringLiteral("running ms"), 11).arg(QStringLiteral("cached ms"), 10) << "\n";
+    for (int r : { 3, 10, 21, 30 }) {
+        const double runningMs = medianMs(runs, [&] {
+            for (const QRect &rect : regions)
+                boxBlurRegion(image, rect, r);
+        });
+        const double cachedMs = medianMs(runs, [&] {
+            for (const QRect &rect : regions)
+                integral.blurRegion(rect, r);
+        });
+        for (const QRect &rect : regions) {
+            if (integral.blurRegion(rect, r) != boxBlurRegion(image, rect, r))
+                identical = false;
+        }
+        out << QString("%1 %2 %3").arg(r, 7).arg(runningMs, 11, 'f', 1).arg(cachedMs, 10, 'f', 1) << "\n";
+    }
+
+    // Strong blurs: full resolution against the reduced levels, which take
+    // one pass over the image the first time they are needed.
+    QElapsedTimer levelTimer;
+    levelTimer.start();
+    integral.reduced(blurScaleFactor(512));
+    out << "\nReduced levels: " << QString::number(levelTimer.nsecsElapsed() / 1.0e6, 'f', 1) << " ms\n";
+
+    out << QString("%1 %2 %3 %4").arg(QStringLiteral("radius"), 7).arg(QStringLiteral("factor"), 7)
+               .arg(QStringLiteral("full ms"), 10).arg(QStringLiteral("reduced ms"), 11) << "\n";
+    for (int r : { 64, 128, 256, 512 }) {
+        const int factor = blurScaleFactor(r);
+        const double fullMs = medianMs(runs, [&] {
+            for (const QRect &rect : regions)
+                boxBlurRegion(image, rect, r);
+        });
+        const double reducedMs = medianMs(runs, [&] {
+            for (const QRect &rect : regions)
+                scaledBoxBlurRegion(integral.reduced(factor), factor, image.size(), rect, r);
+        });
+        out << QString("%1 %2 %3 %4").arg(r, 7).arg(factor, 7)
+                   .arg(fullMs, 10, 'f', 1).arg(reducedMs, 11, 'f', 1) << "\n";
+    }
+
+    if (!identical) {
+        err << "\nCached blur differs from running sums.\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+// A/B comparison of two detectors on a set of photos: per-image latency,
+// throughput, and how well the candidate's boxes agree with the baseline's.
+// Boxes match when they share a class and overlap by at least --match-iou;
+// agreement is reported as precision/recall/F1 of the candidate against the
+// baseline. A model is an .onnx path, a registered "name:precision", a
+// registered name (its default precision) or a precision of the default model.
+//
+//   cleanshare_compare_models --list
+//   cleanshare_compare_models --catalog models/model-info.json photos/
+//   cleanshare_compare_models -a alcohol-detector-v1:fp32 -b other-detector:fp32 photos/
+//   cleanshare_compare_models -a model.onnx -b model.int8.onnx --csv out.csv a.jpg b.jpg
+
+#include "DetectionEngine.h"
+#include "ModelCatalog.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Variant
+{
+    QString label;
+    QString path;
+    double  expectedMs = 0.0;   // from the registry, 0 if unknown
+    DetectionEngine engine;
+};
+
+struct Agreement
+{
+    int    baselineBoxes  = 0;
+    int    candidateBoxes = 0;
+    int    matched        = 0;
+    double iouSum         = 0.0;
+};
+
+double boxIou(const QRect &a, const QRect &b)
+{
+    const QRect inter = a.intersected(b);
+    if (inter.isEmpty())
+        return 0.0;
+    const double i = double(inter.width()) * inter.height();
+    const double u = double(a.width()) * a.height() + double(b.width()) * b.height() - i;
+    return u > 0.0 ? i / u : 0.0;
+}
+
+// Greedy one-to-one matching, most confident candidate boxes first.
+Agreement compare(const std::vector<DetectionResult> &baseline,
+                  std::vector<DetectionResult> candidate, double matchIou)
+{
+    std::sort(candidate.begin(), candidate.end(),
+              [](const DetectionResult &a, const DetectionResult &b) {
+                  return a.confidence > b.confidence;
+              });
+
+    Agreement agreement;
+    agreement.baselineBoxes  = int(baseline.size());
+    agreement.candidateBoxes = int(candidate.size());
+
+    std::vector<bool> used(baseline.size(), false);
+    for (const DetectionResult &c : candidate) {
+        int best = -1;
+        double bestIou = matchIou;
+        for (size_t i = 0; i < baseline.size(); ++i) {
+            if (used[i] || baseline[i].classId != c.classId)
+                continue;
+            const double v = boxIou(baseline[i].box, c.box);
+            if (v >= bestIou) {
+                bestIou = v;
+                best = int(i);
+            }
+        }
+        if (best >= 0) {
+            used[size_t(best)] = true;
+            ++agreement.matched;
+            agreement.iouSum += bestIou;
+        }
+    }
+    return agreement;
+}
+
+double median(std::vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+double mean(const std::vector<double> &values)
+{
+    if (values.empty())
+        return 0.0;
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+    return sum / double(values.size());
+}
+
+// Median wall time of `runs` detections in milliseconds; results of the last run.
+double timeDetection(DetectionEngine &engine, const QImage &image, int runs,
+                     std::vector<DetectionResult> &results)
+{
+    std::vector<double> times;
+    times.reserve(size_t(runs));
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        engine.runDetection(image, results);
+        times.push_back(timer.nsecsElapsed() / 1.0e6);
+    }
+    return median(times);
+}
+
+QStringList collectImages(const QStringList &inputs)
+{
+    QStringList filters;
+    for (const QByteArray &fmt : QImageReader::supportedImageFormats())
+        filters << QStringLiteral("*.") + QString::fromLatin1(fmt);
+
+    QStringList files;
+    for (const QString &input : inputs) {
+        if (QFileInfo(input).isDir()) {
+            QDirIterator it(input, filters, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                files << it.next();
+        } else {
+            files << input;
+        }
+    }
+    files.sort();
+    return files;
+}
+
+// A path to an .onnx file, or a registry entry: "name:precision", "name" or
+// "precision" (of the default model).
+QString resolveVariant(const QString &spec, const ModelCatalog &catalog, double *expectedMs)
+{
+    *expectedMs = 0.0;
+    if (QFileInfo::exists(spec))
+        return spec;
+
+    const ModelInfo *info = nullptr;
+    QString precision;
+    const int colon = spec.indexOf(QLatin1Char(':'));
+    if (colon >= 0) {
+        info = catalog.find(spec.left(colon));
+        precision = spec.mid(colon + 1);
+    } else if ((info = catalog.find(spec))) {
+        precision = catalog.defaultPrecision;
+    } else {
+        info = catalog.defaultInfo();
+        precision = spec;
+    }
+
+    const ModelVariant *variant = info ? info->variant(precision) : nullptr;
+    if (!variant)
+        return {};
+    *expectedMs = variant->expectedLatencyMs;
+    return variant->path;
+}
+
+void listModels(const ModelCatalog &catalog, QTextStream &out)
+{
+    for (const ModelInfo &info : catalog.models) {
+        out << info.name << (info.name == catalog.defaultModel ? "  (default)" : "") << "\n"
+            << "  input    " << info.inputSize << " px\n"
+            << "  classes  " << (info.classes.isEmpty() ? QString("-") : info.classes.join(", ")) << "\n";
+        for (const ModelVariant &v : info.variants) {
+            out << "  " << v.precision.leftJustified(8) << ' ' << v.path
+                << (QFileInfo::exists(v.path) ? "" : "  [missing]");
+            if (v.expectedLatencyMs > 0)
+                out << "  ~" << v.expectedLatencyMs << " ms";
+            out << "\n";
+        }
+        if (!info.pytorchPath.isEmpty())
+            out << "  pytorch  " << info.pytorchPath << "\n";
+    }
+}
+
+QString fmt(double v, int decimals = 2)
+{
+    return QString::number(v, 'f', decimals);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cleanshare_compare_models");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compare latency and detections of two model variants.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("images", "Image files or folders.", "<image|folder>...");
+
+    const QCommandLineOption catalogOpt("catalog", "Model catalog.", "json", "models/model-info.json");
+    const QCommandLineOption baselineOpt({"a", "baseline"}, "Baseline .onnx or precision.", "model", "fp32");
+    const QCommandLineOption candidateOpt({"b", "candidate"}, "Candidate .onnx or precision.", "model", "int8");
+    const QCommandLineOption runsOpt("runs", "Timed runs per image (median is reported).", "n", "5");
+    const QCommandLineOption confOpt("conf", "Confidence threshold.", "value", "0.25");
+    const QCommandLineOption matchOpt("match-iou", "IoU for two boxes to count as the same object.", "value", "0.5");
+    const QCommandLineOption csvOpt("csv", "Also write per-image rows to this CSV file.", "file");
+    const QCommandLineOption listOpt("list", "List the registered models and exit.");
+    parser.addOptions({ catalogOpt, baselineOpt, candidateOpt, runsOpt, confOpt, matchOpt, csvOpt, listOpt });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    ModelCatalog catalog;
+    QString error;
+    if (!loadModelCatalog(parser.value(catalogOpt), &catalog, &error))
+        err << "warning: " << error << "\n";
+
+    if (parser.isSet(listOpt)) {
+        listModels(catalog, out);
+        return 0;
+    }
+
+    const QStringList images = collectImages(parser.positionalArguments());
+    if (images.isEmpty()) {
+        err << "No images given.\n";
+        parser.showHelp(1);
+    }
+
+    const int runs = std::max(1, parser.value(runsOpt).toInt());
+    const float conf = parser.value(confOpt).toFloat();
+    const double matchIou = parser.value(matchOpt).toDouble();
+
+    Variant variants[2];
+    variants[0].label = parser.value(baselineOpt);
+    variants[1].label = parser.value(candidateOpt);
+    for (Variant &v : variants) {
+        v.path = resolveVariant(v.label, catalog, &v.expectedMs);
+        if (v.path.isEmpty() || !v.engine.loadModel(v.path)) {
+            err << "Cannot load " << v.label << ": "
+                << (v.path.isEmpty() ? QString("not in catalog") : v.engine.lastError()) << "\n";
+            return 1;
+        }
+        v.engine.setConfidenceThreshold(conf);
+        v.engine.warmUp();
+    }
+
+    QFile csvFile;
+    QTextStream csv;
+    if (parser.isSet(csvOpt)) {
+        csvFile.setFileName(parser.value(csvOpt));
+        if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            err << "Cannot write " << csvFile.fileName() << ": " << csvFile.errorString() << "\n";
+            return 1;
+        }
+        csv.setDevice(&csvFile);
+        csv << "image,width,height,baseline_ms,candidate_ms,baseline_boxes,candidate_boxes,"
+               "matched,precision,recall,mean_iou\n";
+    }
+
+    out << "baseline:  " << variants[0].path << "\n"
+        << "candidate: " << variants[1].path << "\n\n";
+    out << QString("%1 %2 %3 %4 %5 %6")
+               .arg(QStringLiteral("image"), -32).arg(QStringLiteral("A ms"), 9)
+               .arg(QStringLiteral("B ms"), 9).arg(QStringLiteral("A/B boxes"), 10)
+               .arg(QStringLiteral("match"), 6).arg(QStringLiteral("F1"), 6) << "\n";
+
+    std::vector<double> latencyA, latencyB;
+    Agreement total;
+    int skipped = 0;
+
+    for (const QString &path : images) {
+        const QImage image(path);
+        if (image.isNull()) {
+            err << "skipping unreadable image " << path << "\n";
+            ++skipped;
+            continue;
+        }
+
+        std::vector<DetectionResult> resultsA, resultsB;
+        const double msA = timeDetection(variants[0].engine, image, runs, resultsA);
+        const double msB = timeDetection(variants[1].engine, image, runs, resultsB);
+        latencyA.push_back(msA);
+        latencyB.push_back(msB);
+
+        const Agreement a = compare(resultsA, resultsB, matchIou);
+        total.baselineBoxes  += a.baselineBoxes;
+        total.candidateBoxes += a.candidateBoxes;
+        total.matched        += a.matched;
+        total.iouSum         += a.iouSum;
+
+        const double precision = a.candidateBoxes ? double(a.matched) / a.candidateBoxes : 1.0;
+        const double recall    = a.baselineBoxes  ? double(a.matched) / a.baselineBoxes  : 1.0;
+        const double f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+
+        out << QString("%1 %2 %3 %4 %5 %6")
+                   .arg(QFileInfo(path).fileName().left(32), -32)
+                   .arg(fmt(msA), 9).arg(fmt(msB), 9)
+                   .arg(QString("%1/%2").arg(a.baselineBoxes).arg(a.candidateBoxes), 10)
+                   .arg(a.matched, 6).arg(fmt(f1), 6) << "\n";
+
+        if (csvFile.isOpen()) {
+            csv << '"' << path << "\"," << image.width() << ',' << image.height() << ','
+                << fmt(msA, 3) << ',' << fmt(msB, 3) << ','
+                << a.baselineBoxes << ',' << a.candidateBoxes << ',' << a.matched << ','
+                << fmt(precision, 4) << ',' << fmt(recall, 4) << ','
+                << fmt(a.matched ? a.iouSum / a.matched : 0.0, 4) << "\n";
+        }
+    }
+
+    if (latencyA.empty()) {
+        err << "No readable images.\n";
+        return 1;
+    }
+
+    const double precision = total.candidateBoxes ? double(total.matched) / total.candidateBoxes : 1.0;
+    const double recall    = total.baselineBoxes  ? double(total.matched) / total.baselineBoxes  : 1.0;
+    const double f1 = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+
+    out << "\n" << latencyA.size() << " images";
+    if (skipped)
+        out << " (" << skipped << " skipped)";
+    out << ", " << runs << " timed runs each\n"
+        << "latency ms   baseline mean " << fmt(mean(latencyA)) << " median " << fmt(median(latencyA))
+        << " | candidate mean " << fmt(mean(latencyB)) << " median " << fmt(median(latencyB)) << "\n"
+        << (variants[0].expectedMs > 0 || variants[1].expectedMs > 0
+                ? "expected ms  baseline " + fmt(variants[0].expectedMs) + " | candidate "
+                      + fmt(variants[1].expectedMs) + " (model-info.json)\n"
+                : QString())
+        << "throughput   baseline " << fmt(1000.0 / std::max(mean(latencyA), 1e-9)) << " img/s"
+        << " | candidate " << fmt(1000.0 / std::max(mean(latencyB), 1e-9)) << " img/s\n"
+        << "speedup      " << fmt(mean(latencyA) / std::max(mean(latencyB), 1e-9)) << "x\n"
+        << "boxes        baseline " << total.baselineBoxes << ", candidate " << total.candidateBoxes
+        << ", matched " << total.matched << " (IoU >= " << fmt(matchIou) << ")\n"
+        << "agreement    precision " << fmt(precision, 3) << " recall " << fmt(recall, 3)
+        << " F1 " << fmt(f1, 3)
+        << " mean IoU " << fmt(total.matched ? total.iouSum / total.matched : 0.0, 3) << "\n";
+
+    return 0;
+}
@@ -16,6 +16,7 @@ class QPushButton;
 class QToolButton;
 class QSlider;
 class QSpinBox;
+class QComboBox;
 class QTimer;
 class QDragEnterEvent;
 class QDropEvent;
@@ -43,7 +44,12 @@ private slots:
 
     // Detection & blur
     void onDetectClicked();
+    void onDetectRegionClicked();
+    void onDetectionProgress(const QString &stage);
+    void onDetectionFinished();
     void onDetectionsUpdated(const QVector<QRect> &boxes);
+    void onConfidenceSliderChanged(int value);
+    void onModelChanged(int index);
 
     void onBlurSliderChanged(int value);
     void onBlurSpinChanged(int value);
@@ -71,6 +77,7 @@ private:
     void showImageInPanels();
     void updatePreviewLabels();
     void applyFakeBlur(int strength);
+    void reapplyVisibleBlur();
 
     // Pages
     QStackedWidget *m_pages = nullptr;
@@ -85,6 +92,7 @@ private:
 
     // Toolbar controls
     QPushButton *m_detectButton = nullptr;
+    QPushButton *m_detectRegionButton = nullptr;
     QPushButton *m_manualEditButton = nullptr;
     QPushButton *m_exportButton = nullptr;
     QPushButton *m_undoButton = nullptr;
@@ -97,8 +105,12 @@ private:
     QSpinBox *m_blurSpinBox = nullptr;
     QSlider *m_blurSlider = nullptr;
     QLabel *m_blurValueLabel = nullptr;
+    QSlider *m_confSlider = nullptr;
+    QLabel *m_confValueLabel = nullptr;
+    QComboBox *m_modelCombo = nullptr;
     QTimer *m_blurDebounceTimer = nullptr;
     QFutureWatcher<QPixmap> *m_blurWatcher = nullptr;
+    QFutureWatcher<DetectionOutcome> *m_detectWatcher = nullptr;
 
     int  m_pendingBlurValue = 50;
     bool m_lastSelectionWasAddMode = true;
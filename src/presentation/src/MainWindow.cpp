@@ -1,5 +1,6 @@
 #include "MainWindow.h"
 #include "ImageCanvas.h"
+#include "BitMask.h"
 
 #include <QStackedWidget>
 #include <QApplication>
@@ -18,12 +19,14 @@
 #include <QButtonGroup>
 #include <QSpinBox>
 #include <QSlider>          
+#include <QComboBox>
 #include <QMimeData>        
 #include <QUrl>             
 #include <QtConcurrent/QtConcurrentRun>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QKeyEvent>
+#include <QStatusBar>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -36,6 +39,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_originalImageLabel(nullptr)
     , m_blurredImageCanvas(nullptr)
     , m_detectButton(nullptr)
+    , m_detectRegionButton(nullptr)
     , m_manualEditButton(nullptr)
     , m_exportButton(nullptr)
     , m_undoButton(nullptr)
@@ -59,6 +63,13 @@ MainWindow::MainWindow(QWidget *parent)
     connect(&m_session, &SessionController::detectionsUpdated,
             this, &MainWindow::onDetectionsUpdated);
 
+    // Detection runs off the GUI thread; the watcher reports stages and result
+    m_detectWatcher = new QFutureWatcher<DetectionOutcome>(this);
+    connect(m_detectWatcher, &QFutureWatcher<DetectionOutcome>::progressTextChanged,
+            this, &MainWindow::onDetectionProgress);
+    connect(m_detectWatcher, &QFutureWatcher<DetectionOutcome>::finished,
+            this, &MainWindow::onDetectionFinished);
+
     // Start on the home page
     m_pages->setCurrentWidget(m_homePage);
     setCentralWidget(m_pages);
@@ -66,6 +77,9 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowTitle("CleanShare");
     resize(1200, 800);
 
+    // Load the detector while the user reads the terms below
+    m_session.preloadDetector();
+
     // Terms of Service dialog on startup
     QString tosText =
         "CleanShare is a local tool that helps you blur sensitive information "
@@ -200,6 +214,7 @@ void MainWindow::createPreviewPage()
 
     // --- Top toolbar area (buttons + slider) ---
     m_detectButton      = new QPushButton("Detect", this);
+    m_detectRegionButton = new QPushButton("Detect in Selection", this);
     m_manualEditButton  = new QPushButton("Manual Edit: Off", this);
     m_exportButton      = new QPushButton("Export", this);
     m_undoButton        = new QPushButton("Undo", this);
@@ -214,6 +229,35 @@ void MainWindow::createPreviewPage()
     m_blurSlider->setValue(50);
     m_blurSlider->setEnabled(false);  // Disable until first blur
 
+    // Confidence threshold: re-filters the stored detections, no re-inference
+    m_confSlider = new QSlider(Qt::Horizontal, this);
+    m_confSlider->setRange(int(SessionController::kCandidateConfidence * 100), 95);
+    m_confSlider->setValue(int(m_session.confidenceThreshold() * 100 + 0.5f));
+    m_confSlider->setMaximumWidth(120);
+    m_confSlider->setEnabled(false);  // Disable until first detection
+
+    // Detector choice from models/model-info.json; switching needs no restart
+    m_modelCombo = new QComboBox(this);
+    for (const ModelInfo &info : m_session.modelRegistry().models) {
+        for (const ModelVariant &variant : info.variants) {
+            if (!QFileInfo::exists(variant.path))
+                continue;
+            QString tip = QString("%1 px input").arg(info.inputSize);
+            if (!info.classes.isEmpty())
+                tip += ", classes: " + info.classes.join(", ");
+            if (variant.expectedLatencyMs > 0)
+                tip += QString(", ~%1 ms per image").arg(variant.expectedLatencyMs);
+            m_modelCombo->addItem(QString("%1 (%2)").arg(info.name, variant.precision),
+                                  QStringList{ info.name, variant.precision });
+            m_modelCombo->setItemData(m_modelCombo->count() - 1, tip, Qt::ToolTipRole);
+            if (info.name == m_session.activeModelName() &&
+                variant.precision.compare(m_session.activeModelPrecision(), Qt::CaseInsensitive) == 0) {
+                m_modelCombo->setCurrentIndex(m_modelCombo->count() - 1);
+            }
+        }
+    }
+    m_modelCombo->setVisible(m_modelCombo->count() > 1);
+
     // Selection mode buttons (Replace / Add / Subtract)
     m_selectReplaceButton->setText("Replace");
     m_selectReplaceButton->setCheckable(true);
@@ -237,8 +281,16 @@ void MainWindow::createPreviewPage()
 
     QHBoxLayout *toolbarLayout = new QHBoxLayout();
     toolbarLayout->addWidget(m_detectButton);
+    toolbarLayout->addWidget(m_detectRegionButton);
     toolbarLayout->addWidget(m_manualEditButton);
     toolbarLayout->addWidget(m_exportButton);
+    toolbarLayout->addWidget(m_modelCombo);
+    toolbarLayout->addSpacing(20);
+    toolbarLayout->addWidget(new QLabel("Confidence:", this));
+    toolbarLayout->addWidget(m_confSlider);
+    m_confValueLabel = new QLabel(QString::number(m_confSlider->value()) + "%", this);
+    m_confValueLabel->setMinimumWidth(40);
+    toolbarLayout->addWidget(m_confValueLabel);
     toolbarLayout->addSpacing(20);
     toolbarLayout->addWidget(m_undoButton);
     toolbarLayout->addWidget(m_redoButton);
@@ -298,9 +350,17 @@ void MainWindow::createPreviewPage()
     connect(m_detectButton, &QPushButton::clicked,
             this, &MainWindow::onDetectClicked);
 
+    connect(m_detectRegionButton, &QPushButton::clicked,
+            this, &MainWindow::onDetectRegionClicked);
+
     connect(m_blurSlider, &QSlider::valueChanged,
             this, &MainWindow::onBlurSliderChanged);
 
+    connect(m_confSlider, &QSlider::valueChanged,
+            this, &MainWindow::onConfidenceSliderChanged);
+    connect(m_modelCombo, qOverload<int>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onModelChanged);
+
         connect(m_blurSpinBox, qOverload<int>(&QSpinBox::valueChanged),
             this, &MainWindow::onBlurSpinChanged);
 
@@ -432,18 +492,92 @@ void MainWindow::onDetectClicked()
         return;
     }
 
-    const int strength = m_blurSlider->value();
+    // Already detected for this image: the session just re-emits its boxes
+    if (m_session.hasDetections()) {
+        m_session.runDetection();
+        showImageInPanels();
+        return;
+    }
 
-    QApplication::setOverrideCursor(Qt::WaitCursor);  // or QGuiApplication, both fine
+    if (m_detectWatcher->isRunning())
+        return;
 
-    QString error;
-    bool ok = m_session.autoBlurWithPythonDetections(strength, &error);
+    m_detectButton->setEnabled(false);
+    m_detectRegionButton->setEnabled(false);
+    statusBar()->showMessage("Detecting...");
+
+    // Loading another image cancels this job inside the session
+    m_detectWatcher->setFuture(m_session.detectAsync());
+}
 
-    QApplication::restoreOverrideCursor();            // *** CALL, not definition ***
+void MainWindow::onDetectRegionClicked()
+{
+    if (!m_session.hasImage() || m_detectWatcher->isRunning())
+        return;
+
+    const QRect region = BitMask::fromImage(m_blurredImageCanvas->selectionMask()).boundingRect();
+    if (region.isEmpty()) {
+        QMessageBox::information(
+            this,
+            "No selection",
+            "Turn on Manual Edit and draw around the area to search first."
+        );
+        return;
+    }
+
+    m_detectButton->setEnabled(false);
+    m_detectRegionButton->setEnabled(false);
+    statusBar()->showMessage("Detecting in selection...");
+
+    m_detectWatcher->setFuture(m_session.detectInRegionAsync(region));
+}
+
+void MainWindow::onDetectionProgress(const QString &stage)
+{
+    if (!stage.isEmpty())
+        statusBar()->showMessage("Detecting: " + stage + "...");
+}
 
-    if (!ok) {
+void MainWindow::onDetectionFinished()
+{
+    m_detectButton->setEnabled(true);
+    m_detectRegionButton->setEnabled(true);
+    statusBar()->clearMessage();
+
+    const QFuture<DetectionOutcome> job = m_detectWatcher->future();
+    if (job.isCanceled() || job.resultCount() == 0)
+        return;
+
+    // A result for an image that has since been replaced is just dropped
+    const DetectionOutcome outcome = job.result();
+    if (outcome.imageGeneration != m_session.imageGeneration())
+        return;
+
+    QStringList metrics;
+    if (outcome.adaptive) {
+        const AdaptiveMetrics &m = outcome.metrics;
+        metrics << QString("Coarse pass %1 ms, %2 candidates; ").arg(m.coarseNs / 1000000).arg(m.coarseCandidates)
+                   + (m.fellBackToTiles
+                          ? QString("tiled %1 ms").arg(m.refineNs / 1000000)
+                          : QString("refined %1 areas (%2% of image) in %3 ms")
+                                .arg(m.refinedRegions).arg(m.refinedArea * 100.0, 0, 'f', 1)
+                                .arg(m.refineNs / 1000000));
+    } else if (outcome.fromCache) {
+        metrics << "Detections loaded from cache";
+    }
+    if (m_session.isGateEnabled()) {
+        const GateStats gate = m_session.gateStats();
+        metrics << QString("Pre-check skipped %1 of %2 images, ~%3 s saved")
+                       .arg(gate.imagesSkipped).arg(gate.imagesChecked)
+                       .arg(qMax<qint64>(0, gate.savedTimeNs) / 1.0e9, 0, 'f', 1);
+    }
+    if (!metrics.isEmpty())
+        statusBar()->showMessage(metrics.join(" | "));
+
+    QString error;
+    if (!m_session.applyDetectionOutcome(outcome, &error)) {
         if (error.isEmpty()) {
-            error = "Python detector failed. Check that Python, the model .pt file, and the ultralytics package are installed.";
+            error = "Detection failed. Check that the ONNX model is present, or that Python, the model .pt file, and the ultralytics package are installed.";
         }
         QMessageBox::warning(
             this,
@@ -453,10 +587,14 @@ void MainWindow::onDetectClicked()
         return;
     }
 
+    // A region search merges into the current boxes and keeps the blur
+    if (!outcome.region.isEmpty())
+        reapplyVisibleBlur();
     showImageInPanels();
 
     if (!m_blurSlider->isEnabled())
         m_blurSlider->setEnabled(true);
+    m_confSlider->setEnabled(true);
 }
 
 
@@ -468,6 +606,44 @@ void MainWindow::onDetectionsUpdated(const QVector<QRect> &boxes)
     }
 }
 
+void MainWindow::onConfidenceSliderChanged(int value)
+{
+    if (m_confValueLabel)
+        m_confValueLabel->setText(QString::number(value) + "%");
+
+    // Outlines and mask update right away
+    m_session.setConfidenceThreshold(value / 100.0f);
+    if (m_session.hasDetections())
+        reapplyVisibleBlur();
+}
+
+void MainWindow::onModelChanged(int index)
+{
+    const QStringList model = m_modelCombo->itemData(index).toStringList();
+    if (model.size() != 2)
+        return;
+
+    QString error;
+    if (!m_session.selectModel(model[0], model[1], &error)) {
+        QMessageBox::warning(this, "Model", error);
+        return;
+    }
+    // Loaded in the background; the next Detect uses it
+    m_session.preloadDetector();
+    statusBar()->showMessage(QString("Detector: %1. Run Detect again to use it.")
+                                 .arg(m_modelCombo->itemText(index)), 5000);
+}
+
+void MainWindow::reapplyVisibleBlur()
+{
+    // A visible blur follows a changed mask once input settles
+    if (m_session.blurredPixmap().cacheKey() != m_session.originalPixmap().cacheKey()) {
+        m_pendingBlurValue = m_blurSlider->value();
+        m_blurDebounceTimer->stop();
+        m_blurDebounceTimer->start(100);
+    }
+}
+
 void MainWindow::onBackgroundBlurFinished()
 {
     if (!m_blurWatcher)
@@ -1,9 +1,12 @@
 #!/usr/bin/env python
 
 import argparse
+import gc
 import json
 import os
 import sys
+from contextlib import contextmanager
+from multiprocessing import resource_tracker, shared_memory
 
 try:
     from ultralytics import YOLO
@@ -12,26 +15,9 @@ except ImportError:
     sys.exit(1)
 
 
-def main():
-    parser = argparse.ArgumentParser()
-    parser.add_argument("--model", required=True, help="Path to .pt model")
-    parser.add_argument("--image", required=True, help="Path to input image")
-    parser.add_argument("--conf", type=float, default=0.25, help="Confidence threshold")
-    args = parser.parse_args()
-
-    if not os.path.exists(args.model):
-        sys.stderr.write(f"ERROR: model not found: {args.model}\n")
-        sys.exit(1)
-
-    if not os.path.exists(args.image):
-        sys.stderr.write(f"ERROR: image not found: {args.image}\n")
-        sys.exit(1)
-
-    # Load model on CPU
-    model = YOLO(args.model)
-
+def detect(model, image, conf):
     # Run detection on CPU
-    results = model(args.image, conf=args.conf, device="cpu", verbose=False)[0]
+    results = model(image, conf=conf, device="cpu", verbose=False)[0]
 
     # Original image size
     h, w = results.orig_shape
@@ -42,11 +28,11 @@ def main():
     if boxes is not None and len(boxes) > 0:
         xyxy = boxes.xyxy.cpu().numpy()
         cls = boxes.cls.cpu().numpy()
-        conf = boxes.conf.cpu().numpy()
+        confs = boxes.conf.cpu().numpy()
 
-        for (x1, y1, x2, y2), c, cf in zip(xyxy, cls, conf):
+        for (x1, y1, x2, y2), c, cf in zip(xyxy, cls, confs):
             cf = float(cf)
-            if cf < args.conf:
+            if cf < conf:
                 continue
 
             x = int(round(x1))
@@ -65,13 +51,152 @@ def main():
                 }
             )
 
-    out = {
+    return {
         "width": w,
         "height": h,
         "detections": detections,
     }
 
-    print(json.dumps(out), flush=True)
+
+def forget_last_batch(model):
+    # The predictor holds on to the last input, here a view into shared memory
+    predictor = getattr(model, "predictor", None)
+    if predictor is not None and hasattr(predictor, "batch"):
+        predictor.batch = None
+
+
+def attach_shared_memory(name):
+    # The app owns (and unlinks) the segment; keep Python's resource tracker
+    # from unlinking it when this worker exits.
+    try:
+        return shared_memory.SharedMemory(name=name, track=False)  # Python 3.13+
+    except TypeError:
+        shm = shared_memory.SharedMemory(name=name)
+        if os.name == "posix":
+            resource_tracker.unregister(shm._name, "shared_memory")
+        return shm
+
+
+@contextmanager
+def shared_image(req):
+    # Raw 32-bit rows written by SharedImageBuffer: no file, no codec, no
+    # copy. Yields an HWC BGR view straight into the segment, which stays
+    # mapped until the with block ends.
+    import numpy as np
+
+    width = int(req["width"])
+    height = int(req["height"])
+    stride = int(req["stride"])
+    fmt = req.get("format", "bgra")
+    if fmt not in ("bgra", "argb"):
+        raise ValueError(f"unsupported pixel format: {fmt}")
+
+    shm = attach_shared_memory(req["shm"])
+    try:
+        rows = np.ndarray((height, stride), dtype=np.uint8, buffer=shm.buf)
+        pixels = rows[:, : width * 4].reshape(height, width, 4)
+        # BGR through strides: skip alpha, or walk ARGB backwards
+        yield pixels[:, :, 0:3] if fmt == "bgra" else pixels[:, :, 3:0:-1]
+    finally:
+        rows = pixels = None
+        close_shared_memory(shm)
+
+
+def close_shared_memory(shm):
+    # The segment cannot be unmapped while an array still points into it.
+    # ultralytics keeps the last batch on its predictor, and its results can
+    # sit in reference cycles, so collect once before giving up.
+    try:
+        shm.close()
+    except BufferError:
+        gc.collect()
+        shm.close()
+
+
+def serve(model, default_conf):
+    # Protocol: one JSON object per line on stdin, one reply per line on stdout.
+    # Anything libraries print goes to stderr so stdout only carries replies.
+    out = sys.stdout
+    sys.stdout = sys.stderr
+
+    def reply(obj):
+        out.write(json.dumps(obj) + "\n")
+        out.flush()
+
+    reply({"ready": True})
+
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+
+        try:
+            req = json.loads(line)
+        except ValueError as e:
+            reply({"ok": False, "error": f"bad request: {e}"})
+            continue
+
+        req_id = req.get("id")
+        cmd = req.get("cmd", "detect")
+
+        if cmd == "quit":
+            break
+
+        if cmd == "ping":
+            reply({"id": req_id, "ok": True})
+            continue
+
+        if cmd != "detect":
+            reply({"id": req_id, "ok": False, "error": f"unknown command: {cmd}"})
+            continue
+
+        try:
+            conf = float(req.get("conf", default_conf))
+            if "shm" in req:
+                with shared_image(req) as image:
+                    result = detect(model, image, conf)
+                    # Nothing may point into the segment once the block ends
+                    forget_last_batch(model)
+                    del image
+            else:
+                image = req["image"]
+                if not os.path.exists(image):
+                    raise FileNotFoundError(f"image not found: {image}")
+                result = detect(model, image, conf)
+            result.update({"id": req_id, "ok": True})
+            reply(result)
+        except Exception as e:
+            reply({"id": req_id, "ok": False, "error": str(e)})
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", required=True, help="Path to .pt model")
+    parser.add_argument("--image", help="Path to input image (one-shot mode)")
+    parser.add_argument("--conf", type=float, default=0.25, help="Confidence threshold")
+    parser.add_argument("--serve", action="store_true",
+                        help="Stay resident and answer JSON requests on stdin")
+    args = parser.parse_args()
+
+    if not args.serve and not args.image:
+        parser.error("--image is required unless --serve is given")
+
+    if not os.path.exists(args.model):
+        sys.stderr.write(f"ERROR: model not found: {args.model}\n")
+        sys.exit(1)
+
+    if args.image and not os.path.exists(args.image):
+        sys.stderr.write(f"ERROR: image not found: {args.image}\n")
+        sys.exit(1)
+
+    # Load model on CPU
+    model = YOLO(args.model)
+
+    if args.serve:
+        serve(model, args.conf)
+        return
+
+    print(json.dumps(detect(model, args.image, args.conf)), flush=True)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+
+"""Write an INT8 copy of a YOLO ONNX export next to the FP32 model.
+
+Dynamic quantization needs nothing but the model. Static quantization
+calibrates activation ranges on a folder of representative photos and is
+usually faster on CPU, at the cost of a calibration run.
+
+    python quantize_model.py --model models/alcohol-detector-v1.onnx
+    python quantize_model.py --model models/alcohol-detector-v1.onnx \
+        --mode static --calibration path/to/photos
+"""
+
+import argparse
+import os
+import sys
+
+try:
+    import numpy as np
+    import onnx
+    from onnxruntime.quantization import (
+        CalibrationDataReader,
+        QuantFormat,
+        QuantType,
+        quantize_dynamic,
+        quantize_static,
+    )
+except ImportError:
+    sys.stderr.write("ERROR: 'onnxruntime' not installed. Run: pip install onnxruntime onnx numpy\n")
+    sys.exit(1)
+
+IMAGE_EXTENSIONS = (".jpg", ".jpeg", ".png", ".bmp", ".webp")
+
+
+def input_geometry(model_path):
+    model = onnx.load(model_path, load_external_data=False)
+    inp = model.graph.input[0]
+    dims = [d.dim_value for d in inp.type.tensor_type.shape.dim]
+    height = dims[2] if len(dims) == 4 and dims[2] > 0 else 640
+    width = dims[3] if len(dims) == 4 and dims[3] > 0 else 640
+    return inp.name, width, height
+
+
+def letterbox(path, width, height):
+    # Same preprocessing as DetectionEngine: RGB, aspect-preserving resize,
+    # grey (114) padding, NCHW float in [0, 1].
+    from PIL import Image
+
+    img = Image.open(path).convert("RGB")
+    scale = min(width / img.width, height / img.height)
+    new_w = max(1, round(img.width * scale))
+    new_h = max(1, round(img.height * scale))
+    img = img.resize((new_w, new_h), Image.BILINEAR)
+
+    canvas = Image.new("RGB", (width, height), (114, 114, 114))
+    canvas.paste(img, ((width - new_w) // 2, (height - new_h) // 2))
+
+    arr = np.asarray(canvas, dtype=np.float32) / 255.0
+    return arr.transpose(2, 0, 1)[np.newaxis, ...]
+
+
+class FolderReader(CalibrationDataReader):
+    def __init__(self, folder, input_name, width, height, limit):
+        files = sorted(
+            os.path.join(folder, f)
+            for f in os.listdir(folder)
+            if f.lower().endswith(IMAGE_EXTENSIONS)
+        )
+        if not files:
+            raise FileNotFoundError(f"no images in calibration folder: {folder}")
+        self.files = iter(files[:limit])
+        self.input_name = input_name
+        self.width = width
+        self.height = height
+
+    def get_next(self):
+        path = next(self.files, None)
+        if path is None:
+            return None
+        return {self.input_name: letterbox(path, self.width, self.height)}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--model", required=True, help="Path to FP32 .onnx model")
+    parser.add_argument("--output", help="Output path (default: <model>.int8.onnx)")
+    parser.add_argument("--mode", choices=("dynamic", "static"), default="dynamic")
+    parser.add_argument("--calibration", help="Folder of images for static quantization")
+    parser.add_argument("--calibration-limit", type=int, default=200,
+                        help="Maximum number of calibration images")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.model):
+        sys.stderr.write(f"ERROR: model not found: {args.model}\n")
+        sys.exit(1)
+
+    output = args.output or os.path.splitext(args.model)[0] + ".int8.onnx"
+
+    if args.mode == "dynamic":
+        quantize_dynamic(args.model, output, weight_type=QuantType.QUInt8)
+    else:
+        if not args.calibration:
+            parser.error("--calibration is required for --mode static")
+        input_name, width, height = input_geometry(args.model)
+        reader = FolderReader(args.calibration, input_name, width, height, args.calibration_limit)
+        quantize_static(
+            args.model,
+            output,
+            reader,
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QUInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=True,
+        )
+
+    print(f"wrote {output}", flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+#ifndef BANDPARALLEL_H
+#define BANDPARALLEL_H
+
+#include <functional>
+
+class QThreadPool;
+
+// Pool the redaction kernels split their work over, separate from the global
+// pool so detection jobs and blur bands do not queue behind each other.
+QThreadPool *redactionThreadPool();
+
+// 0 = QThread::idealThreadCount(); 1 runs every kernel on the calling thread.
+void setRedactionThreadCount(int threads);
+int  redactionThreadCount();
+
+// Cuts rows [0, rows) into one horizontal band per pool thread, each at least
+// minRows tall, and calls fn(rowBegin, rowEnd) for each band on the pool.
+// Blocks until all bands are done. A single band runs on the caller.
+void forEachBand(int rows, int minRows, const std::function<void(int, int)> &fn);
+
+#endif // BANDPARALLEL_H
@@ -0,0 +1,59 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QtGlobal>
+#include <vector>
+
+// Selection mask at one bit per pixel, 64 pixels per word: pixel x of a row
+// is bit x % 64 of word x / 64, and bits past the width are always zero.
+// Union, subtraction, counting and bounds work a word at a time.
+//
+// fromImage() sets the pixels of a white-on-transparent mask whose qGray()
+// is above zero, or of a Grayscale8 image that are above zero: every pixel
+// the mask touches at all.
+class BitMask
+{
+public:
+    BitMask() = default;
+    explicit BitMask(const QSize &size); // all clear
+
+    static BitMask fromImage(const QImage &mask);
+
+    // ARGB32_Premultiplied: opaque white where set, transparent elsewhere.
+    // Null for a null mask.
+    QImage toImage() const;
+
+    bool  isNull() const { return m_size.isEmpty(); }
+    QSize size() const   { return m_size; }
+    int   width() const  { return m_size.width(); }
+    int   height() const { return m_size.height(); }
+
+    bool testBit(int x, int y) const
+    {
+        return (row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    // Both leave this mask unchanged if `other` is a different size (or
+    // null), so callers need not check.
+    BitMask &operator|=(const BitMask &other);
+    BitMask &subtract(const BitMask &other); // this & ~other
+
+    void fillRect(const QRect &rect); // sets the pixels of `rect` inside the mask
+
+    qint64 count() const;        // set pixels
+    QRect  boundingRect() const; // null when nothing is set
+
+    int wordsPerRow() const { return m_wordsPerRow; }
+    const quint64 *row(int y) const { return m_words.data() + qsizetype(y) * m_wordsPerRow; }
+    quint64 *row(int y)             { return m_words.data() + qsizetype(y) * m_wordsPerRow; }
+
+private:
+    QSize m_size;
+    int   m_wordsPerRow = 0;
+    std::vector<quint64> m_words;
+};
+
+#endif // BITMASK_H
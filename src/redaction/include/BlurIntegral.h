@@ -0,0 +1,80 @@
+#ifndef BLURINTEGRAL_H
+#define BLURINTEGRAL_H
+
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QtGlobal>
+#include <vector>
+
+// Summed-area table of one image, kept for as long as the image is shown so
+// that each new blur strength costs only the box sampling, O(pixels) at any
+// radius, instead of another pass of running sums.
+//
+// Sums are stored modulo 2^32. A box sum is a difference of four table
+// entries and is exact whenever the true sum fits in 32 bits, which holds for
+// every window of up to kMaxWindowPixels pixels; larger windows fall back to
+// boxBlurRegion(). The table is cut into kTileSize tiles that are built on
+// first use, so only the areas actually blurred take memory (16 bytes per
+// pixel), on top of two small border tables built over the whole image once.
+//
+// Thread-safe: blurRegion() may be called from several threads at once.
+class BlurIntegral
+{
+public:
+    // Nothing is computed until the first blurRegion().
+    explicit BlurIntegral(const QImage &image);
+
+    BlurIntegral(const BlurIntegral &) = delete;
+    BlurIntegral &operator=(const BlurIntegral &) = delete;
+
+    QSize size() const { return m_size; }
+    const QImage &source() const { return m_source; }
+
+    // Same pixels as boxBlurRegion(image, rect, radius).
+    QImage blurRegion(const QRect &rect, int radius);
+
+    // The image averaged down by `factor`, a power of two, for
+    // scaledBoxBlurRegion(). Each level is built once, from the one above.
+    QImage reduced(int factor);
+
+    // Tiles are not built past this many bytes; regions that would need more
+    // are blurred with running sums instead.
+    void   setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+    qint64 memoryUsage() const;
+
+    static constexpr int kTileSize = 128;
+    static constexpr int kMaxWindowPixels = 1 << 23;
+
+private:
+    struct Tile
+    {
+        std::vector<quint32> sums; // (width + 1) x (height + 1) entries of 4 channels
+        int width  = 0;
+        int height = 0;
+    };
+
+    bool ensureTiles(const QRect &area);
+    void buildBorders();
+    void buildTile(int tx, int ty);
+    void windowPrefix(int yTop, int yBottom, int xBegin, int xEnd, quint32 *out) const;
+
+    const QImage m_source;
+    QImage m_pixels;           // straight ARGB32, converted with the borders
+    QSize  m_size;
+    int    m_tilesX = 0;
+    int    m_tilesY = 0;
+
+    mutable QMutex m_mutex;    // guards building; built tiles are read lock-free
+    bool   m_bordersBuilt = false;
+    std::vector<quint32> m_rowBorders;  // sums at the top row of each tile row, plus the bottom
+    std::vector<quint32> m_rowOffsets;  // per tile column and row: sum of the row left of the tile
+    std::vector<Tile> m_tiles;
+    std::vector<QImage> m_levels;       // m_levels[k] is reduced by 2^(k + 1)
+    qint64 m_memoryUsage = 0;
+    qint64 m_memoryLimit = qint64(512) * 1024 * 1024;
+};
+
+#endif // BLURINTEGRAL_H
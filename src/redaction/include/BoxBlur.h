@@ -0,0 +1,43 @@
+#ifndef BOXBLUR_H
+#define BOXBLUR_H
+
+#include <QImage>
+#include <QRect>
+#include <QtGlobal>
+
+// Box blur over a (2 * radius + 1)^2 window clipped to the image: every
+// output byte is the rounded mean (sum + n / 2) / n of the n pixels the
+// window covers, per channel. The four bytes of a pixel are averaged
+// independently, so the channel order does not matter.
+//
+// Separable running sums: one row of per-column sums is slid down the
+// image and a window is slid across it. Scratch memory is one row of
+// 32-bit sums; nothing is proportional to the image area.
+
+// Writes output rows [rowBegin, rowEnd) of a width x height image of 32-bit
+// pixels. Rows outside the range are read but not written, so disjoint
+// ranges can run on different threads.
+void boxBlurRows(const uchar *src, qsizetype srcStride, uchar *dst, qsizetype dstStride,
+                 int width, int height, int radius, int rowBegin, int rowEnd);
+
+// One output row from prefix sums over the window's rows: prefix[4 * x + c]
+// is the sum of channel c over columns [0, x) of those rowCount rows, for x
+// in [0, width], taken modulo 2^32. Writes pixels [xBegin, xEnd) to out[0..].
+// Exact while no window sum reaches 2^32 and windows hold at most 2^23
+// pixels; BlurIntegral samples its table through this.
+void boxBlurRowFromPrefix(const quint32 *prefix, uchar *out, int xBegin, int xEnd,
+                          int width, int radius, int rowCount);
+
+// Blurs straight (non-premultiplied) ARGB and returns ARGB32_Premultiplied,
+// the format SessionController composites in. radius <= 0 returns `src`.
+// Rows are split into bands over redactionThreadPool(); the rows above and
+// below a band that its windows reach are read, never written, so bands
+// need no synchronisation.
+QImage boxBlur(const QImage &src, int radius);
+
+// boxBlur(src, radius).copy(rect), reading only `rect` grown by the radius.
+// Windows are clipped to the image, not to the grown rect, so the pixels
+// match the whole-image blur exactly.
+QImage boxBlurRegion(const QImage &src, const QRect &rect, int radius);
+
+#endif // BOXBLUR_H
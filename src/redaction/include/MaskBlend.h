@@ -0,0 +1,33 @@
+#ifndef MASKBLEND_H
+#define MASKBLEND_H
+
+#include "SoftMask.h"
+
+#include <QImage>
+#include <QRect>
+#include <QRgb>
+
+// Soft-mask compositing of blurred regions over the original: each pixel
+// moves towards the blur by how much of it the mask covers.
+
+// Coverage of each pixel of `rect` (clipped to the mask), as a Grayscale8
+// image of the rect's size.
+//
+// A positive featherRadius softens the edge inwards: the coverage is blurred
+// by a Gaussian of sigma featherRadius / 2 and stretched so that the edge
+// itself ends at 0 and the fade reaches full coverage inside the mask. The
+// result never exceeds the mask, so it stays within maskRegions(), but the
+// outermost pixels of the mask stay partly original.
+QImage maskCoverage(const SoftMask &mask, const QRect &rect, int featherRadius);
+
+// Blends `src`, the blurred pixels of `rect`, into the same rect of `dst`
+// by maskCoverage(mask, rect, featherRadius), in bands on the redaction
+// pool. Both images are ARGB32_Premultiplied and `rect` lies inside `dst`.
+void blendByCoverage(QImage &dst, const QImage &src, const SoftMask &mask, const QRect &rect,
+                     int featherRadius);
+
+// dst[i] = dst[i] + (src[i] - dst[i]) * coverage[i] / 255 on every channel,
+// rounded; premultiplied pixels stay premultiplied. No branches per pixel.
+void blendRow(QRgb *dst, const QRgb *src, const uchar *coverage, int n);
+
+#endif // MASKBLEND_H
@@ -0,0 +1,21 @@
+#ifndef MASKREGIONS_H
+#define MASKREGIONS_H
+
+#include "BitMask.h"
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// Tight bounding rectangles of the set pixels of a mask, one per cluster of
+// touching kMaskCellSize cells, with overlapping rectangles united. Every set
+// pixel lies in exactly one rectangle; the rectangles may also hold unset
+// pixels. Empty for a null or blank mask.
+QVector<QRect> maskRegions(const BitMask &mask);
+
+// Same, for an image mask whose set pixels have qGray > 0.
+QVector<QRect> maskRegions(const QImage &mask);
+
+constexpr int kMaskCellSize = 32;
+
+#endif // MASKREGIONS_H
@@ -0,0 +1,46 @@
+#ifndef REDACTIONKERNEL_H
+#define REDACTIONKERNEL_H
+
+#include <QColor>
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+// What is painted over a masked region.
+enum class RedactionMethod
+{
+    Box,        // one box blur
+    Gaussian,   // three stacked box blurs approximating a Gaussian
+    Pixelate,   // block averages
+    SolidFill   // flat colour
+};
+
+struct RedactionKernel
+{
+    RedactionMethod method = RedactionMethod::Box;
+    int    radius = 8;                 // blur radius; Gaussian sigma is radius / 2; blocks are 2 * radius px
+    QColor color  = Qt::black;         // SolidFill
+};
+
+// "box", "gaussian", "pixelate" or "fill", case-insensitive.
+bool parseRedactionMethod(const QString &name, RedactionMethod *method);
+QString redactionMethodName(RedactionMethod method);
+
+// Redacted pixels of `rect` (clipped to the image), in the format of `src`.
+// ARGB32, RGB32, ARGB32_Premultiplied, RGB888 and Grayscale8 are read and
+// written in place by code compiled for their pixel size, with no per-pixel
+// format handling; other formats are converted to ARGB32_Premultiplied.
+//
+// Blurs average channels as stored with boxBlurRows()' rounding, so a Box
+// region of straight ARGB32 is boxBlurRegion() before premultiplication
+// (and of an opaque image, after). Windows are clipped to the image and
+// only `rect` grown by their reach is read, so a region matches the same
+// kernel run over the whole image. Pixelation blocks sit on a grid anchored
+// at the image origin and average the whole block, also outside `rect`, so
+// neighbouring regions line up.
+QImage applyRedaction(const QImage &src, const QRect &rect, const RedactionKernel &kernel);
+
+// How far outside `rect` applyRedaction() reads, in pixels.
+int redactionReach(const RedactionKernel &kernel);
+
+#endif // REDACTIONKERNEL_H
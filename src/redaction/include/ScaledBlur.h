@@ -0,0 +1,33 @@
+#ifndef SCALEDBLUR_H
+#define SCALEDBLUR_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+
+// Strong blurs at reduced resolution: the image averaged down by a power of
+// two (see BlurIntegral::reduced()) is box blurred at radius / factor around
+// the region, and the result scaled back up with bilinear filtering. Neither
+// step reads full-resolution pixels, so a large radius costs about the same
+// as a small one. The result is smooth but not pixel-identical to
+// boxBlurRegion().
+
+// Radii up to this are blurred at full resolution.
+constexpr int kFullResolutionBlurRadius = 32;
+
+// Reduction for a radius: 1 up to kFullResolutionBlurRadius, then the
+// smallest power of two that brings the radius to half of it or below.
+int blurScaleFactor(int radius);
+
+// Averages each 2x2 block into one ARGB32_Premultiplied pixel; blocks cut
+// off by the right and bottom edges average the pixels they hold.
+QImage halveImage(const QImage &img);
+
+// Blur of `rect` (full-resolution coordinates, clipped to fullSize) at
+// `radius`, from `reduced`: the full image averaged down by `factor` with
+// the grid at the image origin, so neighbouring regions blend seamlessly.
+// Returns ARGB32_Premultiplied like boxBlurRegion().
+QImage scaledBoxBlurRegion(const QImage &reduced, int factor, const QSize &fullSize,
+                           const QRect &rect, int radius);
+
+#endif // SCALEDBLUR_H
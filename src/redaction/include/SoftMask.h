@@ -0,0 +1,73 @@
+#ifndef SOFTMASK_H
+#define SOFTMASK_H
+
+#include "BitMask.h"
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include <vector>
+
+// Selection mask with antialiased edges. Each pixel has a coverage from 0
+// (outside) to 255 (inside); the canvas paints strokes that way, and only
+// pixels along their edge fall in between.
+//
+// So only those pixels store a byte: bits() holds every pixel with any
+// coverage, a second BitMask marks the edge ones, and their coverage is
+// kept in row-major order. Union and subtraction work a word at a time on
+// the bits and visit only the edge pixels of the result.
+class SoftMask
+{
+public:
+    SoftMask() = default;
+    explicit SoftMask(const QSize &size); // all clear
+
+    // Coverage is the qGray() of each premultiplied pixel of a
+    // white-on-transparent mask, or the level of a Grayscale8 image.
+    static SoftMask fromImage(const QImage &mask);
+
+    // Full coverage inside the rects (clipped to `size`), none elsewhere.
+    static SoftMask fromRects(const QSize &size, const QVector<QRect> &rects);
+
+    // ARGB32_Premultiplied: white premultiplied by the coverage, as the
+    // canvas paints masks. Null for a null mask.
+    QImage toImage() const;
+
+    bool  isNull() const { return m_bits.isNull(); }
+    QSize size() const   { return m_bits.size(); }
+    int   width() const  { return m_bits.width(); }
+    int   height() const { return m_bits.height(); }
+
+    // Every pixel with coverage above zero, for maskRegions()
+    const BitMask &bits() const { return m_bits; }
+
+    int coverage(int x, int y) const;
+
+    // Coverage of pixels [x, x + n) of row y into out[0, n)
+    void coverageRow(int y, int x, int n, uchar *out) const;
+
+    // Per pixel max(this, other) and this * (255 - other) / 255, rounded.
+    // Both leave this mask unchanged if `other` is a different size (or
+    // null), so callers need not check.
+    SoftMask &operator|=(const SoftMask &other);
+    SoftMask &subtract(const SoftMask &other);
+
+private:
+    enum class Operation { Unite, Subtract };
+
+    static SoftMask combine(const SoftMask &a, const SoftMask &b, Operation op);
+
+    // Index into m_edgeValues of the first edge pixel at or after (x, y)
+    qsizetype edgeIndex(int x, int y) const;
+
+    // Takes each row's edge coverage, in order, as the mask's
+    void setEdgeValues(const std::vector<std::vector<uchar>> &rowValues);
+
+    BitMask m_bits;                    // coverage > 0
+    BitMask m_edge;                    // 0 < coverage < 255
+    std::vector<uchar> m_edgeValues;   // coverage of the m_edge pixels, row-major
+    std::vector<qsizetype> m_rowStart; // index of each row's first one, then the total
+};
+
+#endif // SOFTMASK_H
@@ -0,0 +1,60 @@
+#include "BandParallel.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+std::atomic<int> g_threadCount{0};
+
+int effectiveThreadCount()
+{
+    const int configured = g_threadCount.load();
+    return configured > 0 ? configured : std::max(1, QThread::idealThreadCount());
+}
+
+} // namespace
+
+QThreadPool *redactionThreadPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+void setRedactionThreadCount(int threads)
+{
+    g_threadCount = std::max(0, threads);
+    redactionThreadPool()->setMaxThreadCount(effectiveThreadCount());
+}
+
+int redactionThreadCount()
+{
+    return effectiveThreadCount();
+}
+
+void forEachBand(int rows, int minRows, const std::function<void(int, int)> &fn)
+{
+    if (rows <= 0)
+        return;
+
+    const int bandCount = std::clamp(rows / std::max(1, minRows), 1, effectiveThreadCount());
+    if (bandCount == 1) {
+        fn(0, rows);
+        return;
+    }
+
+    // Bands differ by at most one row
+    std::vector<std::pair<int, int>> bands;
+    bands.reserve(size_t(bandCount));
+    for (int i = 0; i < bandCount; ++i)
+        bands.emplace_back(int(qint64(rows) * i / bandCount), int(qint64(rows) * (i + 1) / bandCount));
+
+    QtConcurrent::blockingMap(redactionThreadPool(), bands, [&fn](const std::pair<int, int> &band) {
+        fn(band.first, band.second);
+    });
+}
@@ -0,0 +1,159 @@
+#include "BitMask.h"
+#include "BandParallel.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+namespace {
+
+// Rows per band when converting from and to images.
+constexpr int kConvertBandRows = 64;
+
+} // namespace
+
+BitMask::BitMask(const QSize &size)
+    : m_size(size.isEmpty() ? QSize() : size)
+    , m_wordsPerRow(size.isEmpty() ? 0 : (size.width() + 63) / 64)
+    , m_words(size_t(m_wordsPerRow) * size_t(std::max(0, m_size.height())), 0)
+{
+}
+
+BitMask BitMask::fromImage(const QImage &mask)
+{
+    if (mask.isNull())
+        return BitMask();
+
+    // Grey levels are read as they are; anything else through qGray()
+    const bool grey = mask.format() == QImage::Format_Grayscale8;
+    const QImage m = grey || mask.depth() == 32 ? mask : mask.convertToFormat(QImage::Format_ARGB32);
+    BitMask bits(m.size());
+    const int w = m.width();
+    forEachBand(m.height(), kConvertBandRows, [&](int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const uchar *greyLine = m.constScanLine(y);
+            const QRgb *line = reinterpret_cast<const QRgb *>(greyLine);
+            quint64 *words = bits.row(y);
+            for (int x0 = 0; x0 < w; x0 += 64) {
+                const int n = std::min(64, w - x0);
+                quint64 word = 0;
+                if (grey) {
+                    for (int i = 0; i < n; ++i)
+                        word |= quint64(greyLine[x0 + i] > 0) << i;
+                } else {
+                    for (int i = 0; i < n; ++i)
+                        word |= quint64(qGray(line[x0 + i]) > 0) << i;
+                }
+                words[x0 >> 6] = word;
+            }
+        }
+    });
+    return bits;
+}
+
+QImage BitMask::toImage() const
+{
+    if (isNull())
+        return QImage();
+
+    QImage image(m_size, QImage::Format_ARGB32_Premultiplied);
+    uchar *bits = image.bits();
+    const qsizetype bpl = image.bytesPerLine();
+    const int w = width();
+    forEachBand(height(), kConvertBandRows, [&](int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(bits + y * bpl);
+            const quint64 *words = row(y);
+            for (int x = 0; x < w; ++x)
+                line[x] = QRgb(0) - QRgb((words[x >> 6] >> (x & 63)) & 1);
+        }
+    });
+    return image;
+}
+
+BitMask &BitMask::operator|=(const BitMask &other)
+{
+    if (other.m_size != m_size)
+        return *this;
+    for (size_t i = 0; i < m_words.size(); ++i)
+        m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+BitMask &BitMask::subtract(const BitMask &other)
+{
+    if (other.m_size != m_size)
+        return *this;
+    for (size_t i = 0; i < m_words.size(); ++i)
+        m_words[i] &= ~other.m_words[i];
+    return *this;
+}
+
+void BitMask::fillRect(const QRect &rect)
+{
+    const QRect r = rect & QRect(QPoint(0, 0), m_size);
+    if (r.isEmpty())
+        return;
+
+    // Whole words in the middle, masked words at the ends
+    const int first = r.left() >> 6;
+    const int last = r.right() >> 6;
+    const quint64 head = ~quint64(0) << (r.left() & 63);
+    const quint64 tail = ~quint64(0) >> (63 - (r.right() & 63));
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        quint64 *words = row(y);
+        if (first == last) {
+            words[first] |= head & tail;
+            continue;
+        }
+        words[first] |= head;
+        for (int i = first + 1; i < last; ++i)
+            words[i] = ~quint64(0);
+        words[last] |= tail;
+    }
+}
+
+qint64 BitMask::count() const
+{
+    qint64 total = 0;
+    for (quint64 word : m_words)
+        total += qPopulationCount(word);
+    return total;
+}
+
+// Rows from the first and last with a set bit; columns from the OR of all
+// rows in between.
+QRect BitMask::boundingRect() const
+{
+    const auto rowIsEmpty = [this](int y) {
+        const quint64 *words = row(y);
+        return std::all_of(words, words + m_wordsPerRow, [](quint64 word) { return word == 0; });
+    };
+
+    int top = 0;
+    while (top < height() && rowIsEmpty(top))
+        ++top;
+    if (top == height())
+        return QRect();
+    int bottom = height() - 1;
+    while (rowIsEmpty(bottom))
+        --bottom;
+
+    std::vector<quint64> columns(size_t(m_wordsPerRow), 0);
+    for (int y = top; y <= bottom; ++y) {
+        const quint64 *words = row(y);
+        for (int i = 0; i < m_wordsPerRow; ++i)
+            columns[size_t(i)] |= words[i];
+    }
+
+    int first = 0;
+    while (columns[size_t(first)] == 0)
+        ++first;
+    int last = m_wordsPerRow - 1;
+    while (columns[size_t(last)] == 0)
+        --last;
+
+    const int left = first * 64 + int(qCountTrailingZeroBits(columns[size_t(first)]));
+    const int right = last * 64 + 63 - int(qCountLeadingZeroBits(columns[size_t(last)]));
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
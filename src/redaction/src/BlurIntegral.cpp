@@ -0,0 +1,271 @@
+#include "BlurIntegral.h"
+#include "BandParallel.h"
+#include "BoxBlur.h"
+#include "ScaledBlur.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLURINTEGRAL_HAVE_SSE2 1
+#endif
+
+namespace {
+
+// Output rows per band when sampling; each row reads two table rows.
+constexpr int kSampleBandRows = 32;
+
+inline int windowPixels(int radius, int width, int height)
+{
+    return std::min(2 * radius + 1, width) * std::min(2 * radius + 1, height);
+}
+
+// For each of n pixels: run += pixel, then cur[4 * i + c] = prev[4 * i + c]
+// + run[c]. cur may alias prev. Sums wrap modulo 2^32.
+void accumulateRow(const uchar *line, int n, quint32 *run, const quint32 *prev, quint32 *cur)
+{
+#ifdef BLURINTEGRAL_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(run));
+    for (int i = 0; i < n; ++i) {
+        int bytes;
+        std::memcpy(&bytes, line + 4 * i, 4);
+        const __m128i px = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+        acc = _mm_add_epi32(acc, px);
+        const __m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(cur + 4 * i), _mm_add_epi32(above, acc));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(run), acc);
+#else
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            run[c] += line[4 * i + c];
+            cur[4 * i + c] = prev[4 * i + c] + run[c];
+        }
+    }
+#endif
+}
+
+} // namespace
+
+BlurIntegral::BlurIntegral(const QImage &image)
+    : m_source(image)
+    , m_size(image.size())
+{
+    const int t = kTileSize;
+    m_tilesX = (m_size.width() + t - 1) / t;
+    m_tilesY = (m_size.height() + t - 1) / t;
+}
+
+void BlurIntegral::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_memoryLimit = bytes;
+}
+
+qint64 BlurIntegral::memoryLimit() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryLimit;
+}
+
+qint64 BlurIntegral::memoryUsage() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_memoryUsage;
+}
+
+// One pass over the image, a band of tile rows per thread: for every row the
+// sum left of each tile column, and for every tile row the column-wise sums
+// of its rows' prefixes, which added up give the table at its top edge.
+void BlurIntegral::buildBorders()
+{
+    m_pixels = m_source.convertToFormat(QImage::Format_ARGB32);
+
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const int t = kTileSize;
+    const qsizetype borderLen = qsizetype(w + 1) * 4;
+
+    m_rowBorders.assign(size_t(m_tilesY + 1) * borderLen, 0);
+    m_rowOffsets.assign(size_t(m_tilesX) * h * 4, 0);
+
+    forEachBand(m_tilesY, 1, [&](int tyBegin, int tyEnd) {
+        for (int ty = tyBegin; ty < tyEnd; ++ty) {
+            quint32 *delta = m_rowBorders.data() + (ty + 1) * borderLen;
+            for (int y = ty * t; y < std::min(h, (ty + 1) * t); ++y) {
+                const uchar *line = m_pixels.constScanLine(y);
+                quint32 run[4] = { 0, 0, 0, 0 };
+                for (int tx = 0; tx < m_tilesX; ++tx) {
+                    std::copy_n(run, 4, m_rowOffsets.data() + (qsizetype(tx) * h + y) * 4);
+                    const int x0 = tx * t;
+                    quint32 *sums = delta + 4 * (x0 + 1);
+                    accumulateRow(line + 4 * x0, std::min(t, w - x0), run, sums, sums);
+                }
+            }
+        }
+    });
+
+    for (int ty = 1; ty <= m_tilesY; ++ty) {
+        const quint32 *above = m_rowBorders.data() + (ty - 1) * borderLen;
+        quint32 *border = m_rowBorders.data() + ty * borderLen;
+        for (qsizetype i = 0; i < borderLen; ++i)
+            border[i] += above[i];
+    }
+
+    m_tiles.assign(size_t(m_tilesX) * m_tilesY, Tile());
+    m_memoryUsage = qint64(m_rowBorders.size() + m_rowOffsets.size()) * qint64(sizeof(quint32));
+    m_bordersBuilt = true;
+}
+
+// The tile's top edge comes from the row border and each further row adds
+// that row's prefix sums, started from the part of the row left of the tile.
+void BlurIntegral::buildTile(int tx, int ty)
+{
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const int x0 = tx * kTileSize;
+    const int y0 = ty * kTileSize;
+
+    Tile &tile = m_tiles[size_t(ty) * m_tilesX + tx];
+    tile.width  = std::min(kTileSize, w - x0);
+    tile.height = std::min(kTileSize, h - y0);
+    const int stride = (tile.width + 1) * 4;
+    tile.sums.resize(size_t(stride) * (tile.height + 1));
+
+    const quint32 *border = m_rowBorders.data() + qsizetype(ty) * (w + 1) * 4 + x0 * 4;
+    std::copy_n(border, stride, tile.sums.data());
+
+    for (int j = 0; j < tile.height; ++j) {
+        const uchar *line = m_pixels.constScanLine(y0 + j) + 4 * x0;
+        const quint32 *prev = tile.sums.data() + j * stride;
+        quint32 *cur = tile.sums.data() + (j + 1) * stride;
+
+        quint32 run[4];
+        std::copy_n(m_rowOffsets.data() + (qsizetype(tx) * h + y0 + j) * 4, 4, run);
+        for (int c = 0; c < 4; ++c)
+            cur[c] = prev[c] + run[c];
+        accumulateRow(line, tile.width, run, prev + 4, cur + 4);
+    }
+}
+
+// Builds every tile holding a table entry inside `area` (entry coordinates,
+// 0..width x 0..height). False if that would go over the memory limit.
+bool BlurIntegral::ensureTiles(const QRect &area)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_bordersBuilt)
+        buildBorders();
+
+    const int t = kTileSize;
+    const int txBegin = std::min(area.left() / t, m_tilesX - 1);
+    const int txEnd   = std::min(area.right() / t, m_tilesX - 1);
+    const int tyBegin = std::min(area.top() / t, m_tilesY - 1);
+    const int tyEnd   = std::min(area.bottom() / t, m_tilesY - 1);
+
+    std::vector<std::pair<int, int>> missing;
+    qint64 bytes = 0;
+    for (int ty = tyBegin; ty <= tyEnd; ++ty) {
+        for (int tx = txBegin; tx <= txEnd; ++tx) {
+            if (!m_tiles[size_t(ty) * m_tilesX + tx].sums.empty())
+                continue;
+            missing.emplace_back(tx, ty);
+            const int tw = std::min(t, m_size.width() - tx * t);
+            const int th = std::min(t, m_size.height() - ty * t);
+            bytes += qint64(tw + 1) * (th + 1) * 4 * qint64(sizeof(quint32));
+        }
+    }
+    if (missing.empty())
+        return true;
+    if (m_memoryUsage + bytes > m_memoryLimit)
+        return false;
+
+    forEachBand(int(missing.size()), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            buildTile(missing[i].first, missing[i].second);
+    });
+    m_memoryUsage += bytes;
+    return true;
+}
+
+// out[4 * x + c] = table(x, yBottom) - table(x, yTop) for x in xBegin..xEnd
+// (inclusive): prefix sums along the row of the rows in between.
+void BlurIntegral::windowPrefix(int yTop, int yBottom, int xBegin, int xEnd, quint32 *out) const
+{
+    const int t = kTileSize;
+    const int tyTop = std::min(yTop / t, m_tilesY - 1);
+    const int tyBottom = std::min(yBottom / t, m_tilesY - 1);
+
+    for (int x = xBegin; x <= xEnd;) {
+        const int tx = std::min(x / t, m_tilesX - 1);
+        const Tile &top = m_tiles[size_t(tyTop) * m_tilesX + tx];
+        const Tile &bottom = m_tiles[size_t(tyBottom) * m_tilesX + tx];
+        const int stride = (top.width + 1) * 4;
+        const int last = std::min(xEnd, tx * t + top.width);
+
+        const quint32 *topRow = top.sums.data() + (yTop - tyTop * t) * stride + 4 * (x - tx * t);
+        const quint32 *bottomRow = bottom.sums.data() + (yBottom - tyBottom * t) * stride + 4 * (x - tx * t);
+        quint32 *dst = out + 4 * x;
+        for (int i = 0; i < 4 * (last - x + 1); ++i)
+            dst[i] = bottomRow[i] - topRow[i];
+        x = last + 1;
+    }
+}
+
+QImage BlurIntegral::reduced(int factor)
+{
+    QMutexLocker lock(&m_mutex);
+    int level = 0;
+    while ((2 << level) < factor)
+        ++level;
+
+    while (int(m_levels.size()) <= level) {
+        m_levels.push_back(halveImage(m_levels.empty() ? m_source : m_levels.back()));
+        m_memoryUsage += m_levels.back().sizeInBytes();
+    }
+    return m_levels[level];
+}
+
+QImage BlurIntegral::blurRegion(const QRect &rect, int radius)
+{
+    const int w = m_size.width();
+    const int h = m_size.height();
+    const QRect target = rect & QRect(QPoint(0, 0), m_size);
+    if (radius <= 0 || target.isEmpty())
+        return boxBlurRegion(m_source, rect, radius);
+
+    // A window never needs to reach further than the image is long
+    radius = std::min(radius, std::max(w, h));
+    if (windowPixels(radius, w, h) > kMaxWindowPixels)
+        return boxBlurRegion(m_source, rect, radius);
+
+    // Table entries the windows of the target's pixels start and end at
+    const int xBegin = std::max(0, target.left() - radius);
+    const int xEnd   = std::min(w, target.right() + 1 + radius);
+    const int yBegin = std::max(0, target.top() - radius);
+    const int yEnd   = std::min(h, target.bottom() + 1 + radius);
+    if (!ensureTiles(QRect(QPoint(xBegin, yBegin), QPoint(xEnd, yEnd))))
+        return boxBlurRegion(m_source, rect, radius);
+
+    QImage dst(target.size(), QImage::Format_ARGB32);
+    uchar *dstBits = dst.bits();
+    const qsizetype dstBpl = dst.bytesPerLine();
+    forEachBand(target.height(), kSampleBandRows, [&](int rowBegin, int rowEnd) {
+        std::vector<quint32> prefix(size_t(w + 1) * 4);
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const int y = target.top() + row;
+            const int yTop = std::max(0, y - radius);
+            const int yBottom = std::min(h, y + radius + 1);
+            windowPrefix(yTop, yBottom, xBegin, xEnd, prefix.data());
+            boxBlurRowFromPrefix(prefix.data(), dstBits + row * dstBpl, target.left(),
+                                 target.right() + 1, w, radius, yBottom - yTop);
+        }
+    });
+
+    dst.convertTo(QImage::Format_ARGB32_Premultiplied);
+    return dst;
+}
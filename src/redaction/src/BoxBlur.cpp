@@ -0,0 +1,388 @@
+#include "BoxBlur.h"
+#include "BandParallel.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOXBLUR_HAVE_SSE2 1
+#endif
+
+// AVX2 is compiled in on x86-64 regardless of the build's -m flags and only
+// used when the CPU reports it.
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BOXBLUR_HAVE_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define BOXBLUR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define BOXBLUR_TARGET_AVX2
+#endif
+#endif
+
+namespace {
+
+// Window sums of up to this many pixels take the SIMD path; see Divider.
+constexpr int kMaxSimdCount = 1 << 22;
+
+// Each band first sums the 2 * radius + 1 rows around its top row; keep
+// bands tall enough that this halo stays a small part of their work.
+inline int minBandRows(int radius)
+{
+    return std::max(16, 4 * (2 * radius + 1));
+}
+
+inline int windowLength(int pos, int radius, int length)
+{
+    return std::min(length - 1, pos + radius) - std::max(0, pos - radius) + 1;
+}
+
+#ifdef BOXBLUR_HAVE_AVX2
+bool cpuHasAvx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#endif
+}
+
+// updateColumns() 32 bytes at a time; returns how many it did.
+BOXBLUR_TARGET_AVX2
+int updateColumnsAvx2(quint32 *colSum, const uchar *add, const uchar *sub, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int half = 0; half < 32; half += 16) {
+            const __m128i a = add ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i + half)) : zero;
+            const __m128i s = sub ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i + half)) : zero;
+            const __m256i diff = _mm256_sub_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(s));
+            const __m256i d[2] = {
+                _mm256_cvtepi16_epi32(_mm256_castsi256_si128(diff)),
+                _mm256_cvtepi16_epi32(_mm256_extracti128_si256(diff, 1)),
+            };
+            for (int k = 0; k < 2; ++k) {
+                __m256i *c = reinterpret_cast<__m256i *>(colSum + i + half + 8 * k);
+                _mm256_storeu_si256(c, _mm256_add_epi32(_mm256_loadu_si256(c), d[k]));
+            }
+        }
+    }
+    return i;
+}
+#endif
+
+// colSum[i] += add[i] - sub[i] over n bytes; either row may be null.
+// Intermediate values wrap, the result is the exact new column sum.
+// The horizontal pass stays on SSE2: its running sum moves one pixel, one
+// 128-bit lane, at a time, so wider registers would not shorten it.
+void updateColumns(quint32 *colSum, const uchar *add, const uchar *sub, int n)
+{
+    int i = 0;
+#ifdef BOXBLUR_HAVE_AVX2
+    static const bool hasAvx2 = cpuHasAvx2();
+    if (hasAvx2)
+        i = updateColumnsAvx2(colSum, add, sub, n);
+#endif
+#ifdef BOXBLUR_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        // add - sub per byte as a 16-bit signed value
+        const __m128i a = add ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + i)) : zero;
+        const __m128i s = sub ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + i)) : zero;
+        const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(s, zero));
+        const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(s, zero));
+        const __m128i loSign = _mm_cmpgt_epi16(zero, lo);
+        const __m128i hiSign = _mm_cmpgt_epi16(zero, hi);
+        const __m128i d[4] = {
+            _mm_unpacklo_epi16(lo, loSign), _mm_unpackhi_epi16(lo, loSign),
+            _mm_unpacklo_epi16(hi, hiSign), _mm_unpackhi_epi16(hi, hiSign),
+        };
+        for (int k = 0; k < 4; ++k) {
+            __m128i *c = reinterpret_cast<__m128i *>(colSum + i + 4 * k);
+            _mm_storeu_si128(c, _mm_add_epi32(_mm_loadu_si128(c), d[k]));
+        }
+    }
+#endif
+    for (; i < n; ++i)
+        colSum[i] += quint32(add ? add[i] : 0) - quint32(sub ? sub[i] : 0);
+}
+
+// Horizontal pass, scalar and exact for any window size.
+void blurRowScalar(const quint32 *colSum, uchar *out, int width, int radius, int rowCount)
+{
+    quint64 acc[4] = { 0, 0, 0, 0 };
+    for (int x = 0; x <= std::min(radius, width - 1); ++x) {
+        for (int c = 0; c < 4; ++c)
+            acc[c] += colSum[4 * x + c];
+    }
+
+    for (int x = 0; x < width; ++x) {
+        const quint64 count = quint64(windowLength(x, radius, width)) * quint64(rowCount);
+        for (int c = 0; c < 4; ++c)
+            out[4 * x + c] = uchar((acc[c] + count / 2) / count);
+
+        const int enter = x + radius + 1;
+        const int leave = x - radius;
+        for (int c = 0; c < 4; ++c) {
+            if (enter < width)
+                acc[c] += colSum[4 * enter + c];
+            if (leave >= 0)
+                acc[c] -= colSum[4 * leave + c];
+        }
+    }
+}
+
+#ifdef BOXBLUR_HAVE_SSE2
+// n / d as (n * m) >> shift. With shift = 31 + ceil(log2 d) and m rounded
+// up, the error term stays below 1 / d for every n < 256 * d (all that a
+// mean of bytes can reach) while d <= 2^23, so the quotient is exact.
+struct Divider
+{
+    __m128i m;
+    __m128i shift;
+
+    explicit Divider(quint32 d)
+    {
+        int log2d = 0;
+        while ((quint64(1) << log2d) < d)
+            ++log2d;
+        const int s = 31 + log2d;
+        const quint64 mul = ((quint64(1) << s) + d - 1) / d;
+        m = _mm_set1_epi32(int(quint32(mul)));
+        shift = _mm_cvtsi32_si128(s);
+    }
+
+    __m128i divide(__m128i n) const
+    {
+        const __m128i even = _mm_srl_epi64(_mm_mul_epu32(n, m), shift);
+        const __m128i odd  = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(n, 32), m), shift);
+        return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+    }
+};
+
+inline __m128i loadPixel(const quint32 *colSum, int x)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(colSum + 4 * x));
+}
+
+inline void storePixel(uchar *out, __m128i q)
+{
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q, q), q);
+    const int v = _mm_cvtsi128_si32(packed);
+    std::copy_n(reinterpret_cast<const uchar *>(&v), 4, out);
+}
+
+// Horizontal pass for windows of at most kMaxSimdCount pixels: sums stay in
+// 32 bits and the interior, where the window has a constant size, divides
+// by a precomputed multiplier four pixels at a time.
+void blurRowSse2(const quint32 *colSum, uchar *out, int width, int radius, int rowCount)
+{
+    __m128i acc = _mm_setzero_si128();
+    for (int x = 0; x <= std::min(radius, width - 1); ++x)
+        acc = _mm_add_epi32(acc, loadPixel(colSum, x));
+
+    auto advance = [&](int x) {
+        if (x + radius + 1 < width)
+            acc = _mm_add_epi32(acc, loadPixel(colSum, x + radius + 1));
+        if (x - radius >= 0)
+            acc = _mm_sub_epi32(acc, loadPixel(colSum, x - radius));
+    };
+
+    auto edgePixel = [&](int x) {
+        const quint32 count = quint32(windowLength(x, radius, width) * rowCount);
+        alignas(16) quint32 sum[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(sum), acc);
+        for (int c = 0; c < 4; ++c)
+            out[4 * x + c] = uchar((sum[c] + count / 2) / count);
+        advance(x);
+    };
+
+    // Full-width windows only where the whole window fits in the row
+    const int interiorBegin = std::min(radius, width);
+    const int interiorEnd = std::max(interiorBegin, width - radius);
+
+    int x = 0;
+    for (; x < interiorBegin; ++x)
+        edgePixel(x);
+
+    if (x < interiorEnd) {
+        const quint32 count = quint32((2 * radius + 1) * rowCount);
+        const Divider divider(count);
+        const __m128i half = _mm_set1_epi32(int(count / 2));
+
+        for (; x + 4 <= interiorEnd; x += 4) {
+            __m128i q[4];
+            for (int k = 0; k < 4; ++k) {
+                q[k] = divider.divide(_mm_add_epi32(acc, half));
+                advance(x + k);
+            }
+            const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]),
+                                                    _mm_packs_epi32(q[2], q[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * x), packed);
+        }
+        for (; x < interiorEnd; ++x) {
+            storePixel(out + 4 * x, divider.divide(_mm_add_epi32(acc, half)));
+            advance(x);
+        }
+    }
+
+    for (; x < width; ++x)
+        edgePixel(x);
+}
+
+// Interior pixels [begin, end) of a row from window prefix sums, written
+// from out[0]; every window there spans 2 * radius + 1 columns.
+void prefixInteriorSse2(const quint32 *prefix, uchar *out, int begin, int end, int radius, int rowCount)
+{
+    const quint32 count = quint32((2 * radius + 1) * rowCount);
+    const Divider divider(count);
+    const __m128i half = _mm_set1_epi32(int(count / 2));
+    auto windowSum = [&](int x) {
+        return _mm_add_epi32(_mm_sub_epi32(loadPixel(prefix, x + radius + 1), loadPixel(prefix, x - radius)), half);
+    };
+
+    int x = begin;
+    for (; x + 4 <= end; x += 4) {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k)
+            q[k] = divider.divide(windowSum(x + k));
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]),
+                                                _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * (x - begin)), packed);
+    }
+    for (; x < end; ++x)
+        storePixel(out + 4 * (x - begin), divider.divide(windowSum(x)));
+}
+#endif
+
+} // namespace
+
+void boxBlurRowFromPrefix(const quint32 *prefix, uchar *out, int xBegin, int xEnd,
+                          int width, int radius, int rowCount)
+{
+    auto scalarPixel = [&](int x) {
+        const int left = std::max(0, x - radius);
+        const int right = std::min(width, x + radius + 1);
+        const quint64 count = quint64(right - left) * quint64(rowCount);
+        for (int c = 0; c < 4; ++c) {
+            const quint64 sum = prefix[4 * right + c] - prefix[4 * left + c];
+            out[4 * (x - xBegin) + c] = uchar((sum + count / 2) / count);
+        }
+    };
+
+    // Windows clipped by neither edge
+    const int interiorBegin = std::clamp(radius, xBegin, std::max(xBegin, xEnd));
+    const int interiorEnd = std::clamp(width - radius, interiorBegin, std::max(interiorBegin, xEnd));
+
+    int x = xBegin;
+    for (; x < interiorBegin; ++x)
+        scalarPixel(x);
+#ifdef BOXBLUR_HAVE_SSE2
+    if (x < interiorEnd) {
+        prefixInteriorSse2(prefix, out + 4 * (x - xBegin), x, interiorEnd, radius, rowCount);
+        x = interiorEnd;
+    }
+#endif
+    for (; x < xEnd; ++x)
+        scalarPixel(x);
+}
+
+void boxBlurRows(const uchar *src, qsizetype srcStride, uchar *dst, qsizetype dstStride,
+                 int width, int height, int radius, int rowBegin, int rowEnd)
+{
+    rowBegin = std::max(rowBegin, 0);
+    rowEnd = std::min(rowEnd, height);
+    if (width <= 0 || rowBegin >= rowEnd)
+        return;
+
+    // A window never needs to reach further than the image is long
+    radius = std::clamp(radius, 0, std::max(width, height));
+
+    const int rowBytes = 4 * width;
+    std::vector<quint32> colSum(size_t(rowBytes), 0);
+
+    const int top = std::max(0, rowBegin - radius);
+    const int bottom = std::min(height - 1, rowBegin + radius);
+    for (int y = top; y <= bottom; ++y)
+        updateColumns(colSum.data(), src + y * srcStride, nullptr, rowBytes);
+
+#ifdef BOXBLUR_HAVE_SSE2
+    const bool simd = qint64(std::min(2 * radius + 1, width)) * std::min(2 * radius + 1, height)
+                      <= kMaxSimdCount;
+#endif
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const int rowCount = windowLength(y, radius, height);
+        uchar *out = dst + y * dstStride;
+
+#ifdef BOXBLUR_HAVE_SSE2
+        if (simd)
+            blurRowSse2(colSum.data(), out, width, radius, rowCount);
+        else
+#endif
+            blurRowScalar(colSum.data(), out, width, radius, rowCount);
+
+        if (y + 1 < rowEnd) {
+            const int enter = y + radius + 1;
+            const int leave = y - radius;
+            updateColumns(colSum.data(),
+                          enter < height ? src + enter * srcStride : nullptr,
+                          leave >= 0 ? src + leave * srcStride : nullptr, rowBytes);
+        }
+    }
+}
+
+QImage boxBlur(const QImage &src, int radius)
+{
+    if (radius <= 0 || src.isNull())
+        return src;
+
+    // Averaged straight, not premultiplied, then premultiplied for compositing
+    const QImage img = src.convertToFormat(QImage::Format_ARGB32);
+    QImage dst(img.size(), QImage::Format_ARGB32);
+    const uchar *in = img.constBits();
+    uchar *out = dst.bits();
+    forEachBand(img.height(), minBandRows(radius), [&](int rowBegin, int rowEnd) {
+        boxBlurRows(in, img.bytesPerLine(), out, dst.bytesPerLine(),
+                    img.width(), img.height(), radius, rowBegin, rowEnd);
+    });
+
+    dst.convertTo(QImage::Format_ARGB32_Premultiplied);
+    return dst;
+}
+
+QImage boxBlurRegion(const QImage &src, const QRect &rect, int radius)
+{
+    const QRect target = rect & src.rect();
+    if (radius <= 0 || target.isEmpty())
+        return src.copy(target);
+
+    // Every window around a target pixel lies inside the grown rect, and is
+    // clipped by the image edge exactly where the grown rect is.
+    const QRect grown = target.adjusted(-radius, -radius, radius, radius) & src.rect();
+    const QImage img = src.copy(grown).convertToFormat(QImage::Format_ARGB32);
+
+    QImage out(grown.size(), QImage::Format_ARGB32);
+    const uchar *in = img.constBits();
+    uchar *outBits = out.bits();
+    const int firstRow = target.top() - grown.top();
+    forEachBand(target.height(), minBandRows(radius), [&](int rowBegin, int rowEnd) {
+        boxBlurRows(in, img.bytesPerLine(), outBits, out.bytesPerLine(),
+                    img.width(), img.height(), radius, firstRow + rowBegin, firstRow + rowEnd);
+    });
+
+    QImage dst = out.copy(target.translated(-grown.topLeft()));
+    dst.convertTo(QImage::Format_ARGB32_Premultiplied);
+    return dst;
+}
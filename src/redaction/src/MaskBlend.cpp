@@ -0,0 +1,138 @@
+#include "MaskBlend.h"
+#include "BandParallel.h"
+#include "RedactionKernel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MASKBLEND_HAVE_SSE2 1
+#endif
+
+namespace {
+
+// Rows per band when reading coverage or blending, which do little work
+// per pixel.
+constexpr int kCoverageBandRows = 64;
+constexpr int kBlendBandRows = 64;
+
+// round(x / 255) for x <= 255 * 255
+inline uint divide255(uint x)
+{
+    return ((x + 128) * 257) >> 16;
+}
+
+// Coverage of `rect`, which lies inside the mask
+QImage coveragePlane(const SoftMask &mask, const QRect &rect)
+{
+    QImage plane(rect.size(), QImage::Format_Grayscale8);
+    uchar *planeBits = plane.bits();
+    const qsizetype planeBpl = plane.bytesPerLine();
+    forEachBand(rect.height(), kCoverageBandRows, [&](int rowBegin, int rowEnd) {
+        for (int row = rowBegin; row < rowEnd; ++row)
+            mask.coverageRow(rect.top() + row, rect.left(), rect.width(), planeBits + row * planeBpl);
+    });
+    return plane;
+}
+
+} // namespace
+
+QImage maskCoverage(const SoftMask &mask, const QRect &rect, int featherRadius)
+{
+    const QRect target = rect & QRect(QPoint(0, 0), mask.size());
+    if (target.isEmpty())
+        return QImage();
+
+    if (featherRadius <= 0)
+        return coveragePlane(mask, target);
+
+    RedactionKernel feather;
+    feather.method = RedactionMethod::Gaussian;
+    feather.radius = featherRadius;
+
+    // The blur reads the coverage around the rect as far as it reaches
+    const int reach = redactionReach(feather);
+    const QRect source = target.adjusted(-reach, -reach, reach, reach) & QRect(QPoint(0, 0), mask.size());
+    const QImage plane = coveragePlane(mask, source);
+    const QPoint offset = target.topLeft() - source.topLeft();
+
+    // Blurred, the edge sits at half coverage; 2g - 255 moves it to zero,
+    // and the mask itself caps it where the blur spread outwards
+    QImage soft = applyRedaction(plane, target.translated(-source.topLeft()), feather);
+    for (int y = 0; y < soft.height(); ++y) {
+        uchar *line = soft.scanLine(y);
+        const uchar *covLine = plane.constScanLine(offset.y() + y) + offset.x();
+        for (int x = 0; x < soft.width(); ++x)
+            line[x] = uchar(std::clamp(2 * int(line[x]) - 255, 0, int(covLine[x])));
+    }
+    return soft;
+}
+
+void blendByCoverage(QImage &dst, const QImage &src, const SoftMask &mask, const QRect &rect,
+                     int featherRadius)
+{
+    // Without a feather the coverage is read straight into each band's row
+    // buffer; a feathered one has to be blurred as a whole first
+    const QImage feathered = featherRadius > 0 ? maskCoverage(mask, rect, featherRadius) : QImage();
+
+    // Detach once here; the bands below write through the raw pointer
+    uchar *dstBits = dst.bits();
+    const qsizetype dstBpl = dst.bytesPerLine();
+    forEachBand(rect.height(), kBlendBandRows, [&](int rowBegin, int rowEnd) {
+        std::vector<uchar> coverage(feathered.isNull() ? size_t(rect.width()) : 0, 0);
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const uchar *covLine = feathered.isNull() ? coverage.data() : feathered.constScanLine(row);
+            if (feathered.isNull())
+                mask.coverageRow(rect.top() + row, rect.left(), rect.width(), coverage.data());
+            QRgb *dstLine = reinterpret_cast<QRgb *>(dstBits + (rect.top() + row) * dstBpl);
+            blendRow(dstLine + rect.left(), reinterpret_cast<const QRgb *>(src.constScanLine(row)),
+                     covLine, rect.width());
+        }
+    });
+}
+
+// Per channel (dst * (255 - a) + src * a + 128) * 257 >> 16: both products
+// sum to at most 255 * 255, so the whole lerp stays in 16-bit lanes.
+void blendRow(QRgb *dst, const QRgb *src, const uchar *coverage, int n)
+{
+    int i = 0;
+#ifdef MASKBLEND_HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i scale = _mm_set1_epi16(257);
+    for (; i + 4 <= n; i += 4) {
+        int cov;
+        std::memcpy(&cov, coverage + i, 4);
+        // Each coverage byte repeated over its pixel's four channels
+        const __m128i a8 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(cov), _mm_cvtsi32_si128(cov));
+        const __m128i a = _mm_unpacklo_epi16(a8, a8);
+
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+
+        const __m128i aLo = _mm_unpacklo_epi8(a, zero);
+        const __m128i aHi = _mm_unpackhi_epi8(a, zero);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, aLo)),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), aLo));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, aHi)),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), aHi));
+        lo = _mm_mulhi_epu16(_mm_add_epi16(lo, half), scale);
+        hi = _mm_mulhi_epu16(_mm_add_epi16(hi, half), scale);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint a = coverage[i];
+        const QRgb d = dst[i];
+        const QRgb s = src[i];
+        QRgb out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            const uint c = divide255(((d >> shift) & 0xff) * (255 - a) + ((s >> shift) & 0xff) * a);
+            out |= QRgb(c) << shift;
+        }
+        dst[i] = out;
+    }
+}
@@ -0,0 +1,95 @@
+#include "MaskRegions.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <vector>
+
+QVector<QRect> maskRegions(const BitMask &mask)
+{
+    QVector<QRect> regions;
+    if (mask.isNull())
+        return regions;
+
+    static_assert(64 % kMaskCellSize == 0, "cells must not straddle mask words");
+    constexpr int cellsPerWord = 64 / kMaskCellSize;
+    constexpr quint64 cellBits = ~quint64(0) >> (64 - kMaskCellSize);
+
+    const int w = mask.width();
+    const int h = mask.height();
+    const int gw = (w + kMaskCellSize - 1) / kMaskCellSize;
+    const int gh = (h + kMaskCellSize - 1) / kMaskCellSize;
+
+    // Tight bounds of the set pixels in each cell; null rect = cell is empty.
+    // A cell's row is a slice of one word: its first and last set bits.
+    std::vector<QRect> cells(size_t(gw) * size_t(gh));
+    for (int y = 0; y < h; ++y) {
+        const quint64 *words = mask.row(y);
+        QRect *rowCells = cells.data() + size_t(y / kMaskCellSize) * size_t(gw);
+        for (int i = 0; i < mask.wordsPerRow(); ++i) {
+            if (words[i] == 0)
+                continue;
+            for (int c = 0; c < cellsPerWord; ++c) {
+                const quint64 bits = (words[i] >> (c * kMaskCellSize)) & cellBits;
+                if (bits == 0)
+                    continue;
+                const int x0 = i * 64 + c * kMaskCellSize;
+                const int first = int(qCountTrailingZeroBits(bits));
+                const int last = 63 - int(qCountLeadingZeroBits(bits));
+                rowCells[x0 / kMaskCellSize] |= QRect(x0 + first, y, last - first + 1, 1);
+            }
+        }
+    }
+
+    // Clusters of 8-connected occupied cells
+    std::vector<char> visited(cells.size(), 0);
+    std::vector<int> stack;
+    for (int start = 0; start < int(cells.size()); ++start) {
+        if (visited[size_t(start)] || cells[size_t(start)].isNull())
+            continue;
+
+        QRect bounds;
+        visited[size_t(start)] = 1;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            const int i = stack.back();
+            stack.pop_back();
+            bounds |= cells[size_t(i)];
+
+            const int cx = i % gw;
+            const int cy = i / gw;
+            for (int ny = std::max(0, cy - 1); ny <= std::min(gh - 1, cy + 1); ++ny) {
+                for (int nx = std::max(0, cx - 1); nx <= std::min(gw - 1, cx + 1); ++nx) {
+                    const int n = ny * gw + nx;
+                    if (!visited[size_t(n)] && !cells[size_t(n)].isNull()) {
+                        visited[size_t(n)] = 1;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+        regions.push_back(bounds);
+    }
+
+    // Bounding boxes of separate clusters can still overlap; unite those so
+    // no pixel is processed twice.
+    for (bool merged = true; merged; ) {
+        merged = false;
+        for (int i = 0; i < regions.size() && !merged; ++i) {
+            for (int j = i + 1; j < regions.size(); ++j) {
+                if (regions[i].intersects(regions[j])) {
+                    regions[i] |= regions[j];
+                    regions.removeAt(j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    return regions;
+}
+
+QVector<QRect> maskRegions(const QImage &mask)
+{
+    return maskRegions(BitMask::fromImage(mask));
+}
@@ -0,0 +1,293 @@
+#include "RedactionKernel.h"
+#include "BandParallel.h"
+#include "BoxBlur.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Box radii whose three passes come closest to a Gaussian of this sigma
+// (Kovesi, "Fast almost-Gaussian filtering"). Small sigmas round to radius
+// 0, which would leave the image as it is, so every pass blurs at least 1.
+QVector<int> gaussianBoxRadii(double sigma)
+{
+    constexpr int passes = 3;
+    const double ideal = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lower = int(std::floor(ideal));
+    if (lower % 2 == 0)
+        --lower;
+    const int upper = lower + 2;
+    const int lowerPasses = int(std::lround((12.0 * sigma * sigma - passes * lower * lower
+                                             - 4.0 * passes * lower - 3.0 * passes)
+                                            / (-4.0 * lower - 4.0)));
+
+    QVector<int> radii;
+    for (int i = 0; i < passes; ++i)
+        radii.push_back(std::max(1, ((i < lowerPasses ? lower : upper) - 1) / 2));
+    return radii;
+}
+
+// boxBlurRows() for pixels of Channels bytes: a row of column sums slid down
+// the image and a window slid across it, each output byte the rounded mean
+// of the clipped (2 * radius + 1)^2 window. Four-byte pixels take
+// boxBlurRows() itself, so a Box pass is the same arithmetic as boxBlur().
+template <int Channels>
+void boxPassRows(const uchar *src, qsizetype srcStride, uchar *dst, qsizetype dstStride,
+                 int width, int height, int radius, int rowBegin, int rowEnd)
+{
+    if constexpr (Channels == 4) {
+        boxBlurRows(src, srcStride, dst, dstStride, width, height, radius, rowBegin, rowEnd);
+    } else {
+        rowBegin = std::max(rowBegin, 0);
+        rowEnd = std::min(rowEnd, height);
+        if (width <= 0 || rowBegin >= rowEnd)
+            return;
+
+        // A window never needs to reach further than the image is long
+        radius = std::clamp(radius, 0, std::max(width, height));
+        const auto windowLength = [radius](int pos, int length) {
+            return std::min(length - 1, pos + radius) - std::max(0, pos - radius) + 1;
+        };
+
+        const int rowBytes = Channels * width;
+        std::vector<quint32> colSum(size_t(rowBytes), 0);
+        const auto updateColumns = [&](int add, int sub) {
+            const uchar *a = add < height ? src + add * srcStride : nullptr;
+            const uchar *s = sub >= 0 ? src + sub * srcStride : nullptr;
+            for (int i = 0; i < rowBytes; ++i)
+                colSum[size_t(i)] += quint32(a ? a[i] : 0) - quint32(s ? s[i] : 0);
+        };
+
+        for (int y = std::max(0, rowBegin - radius); y <= std::min(height - 1, rowBegin + radius); ++y)
+            updateColumns(y, -1);
+
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const quint64 rowCount = quint64(windowLength(y, height));
+            uchar *out = dst + y * dstStride;
+
+            quint64 acc[Channels] = {};
+            for (int x = 0; x <= std::min(radius, width - 1); ++x) {
+                for (int c = 0; c < Channels; ++c)
+                    acc[c] += colSum[size_t(Channels * x + c)];
+            }
+            for (int x = 0; x < width; ++x) {
+                const quint64 count = quint64(windowLength(x, width)) * rowCount;
+                for (int c = 0; c < Channels; ++c)
+                    out[Channels * x + c] = uchar((acc[c] + count / 2) / count);
+
+                const int enter = x + radius + 1;
+                const int leave = x - radius;
+                for (int c = 0; c < Channels; ++c) {
+                    if (enter < width)
+                        acc[c] += colSum[size_t(Channels * enter + c)];
+                    if (leave >= 0)
+                        acc[c] -= colSum[size_t(Channels * leave + c)];
+                }
+            }
+
+            if (y + 1 < rowEnd)
+                updateColumns(y + radius + 1, y - radius);
+        }
+    }
+}
+
+// One box pass per radius in turn over `target`, on the pixels as stored.
+// Every window around a target pixel lies inside the grown rect, and is
+// clipped by the image edge exactly where the grown rect is. Windows clipped
+// at a cut edge are wrong, but each pass only computes the rows the later
+// passes read, and columns within the reach of a cut never reach the target.
+template <int Channels>
+QImage boxBlurPasses(const QImage &src, const QRect &target, const QVector<int> &radii)
+{
+    int reach = 0;
+    for (int r : radii)
+        reach += r;
+    const QRect grown = target.adjusted(-reach, -reach, reach, reach) & src.rect();
+
+    QImage img = src.copy(grown);
+    QImage tmp(img.size(), img.format());
+    int rest = reach;
+    for (int radius : radii) {
+        rest -= radius;
+        const int rowBegin = std::max(0, target.top() - grown.top() - rest);
+        const int rowEnd = std::min(img.height(), target.bottom() + 1 - grown.top() + rest);
+        const uchar *in = img.constBits();
+        uchar *out = tmp.bits();
+        const qsizetype inBpl = img.bytesPerLine();
+        const qsizetype outBpl = tmp.bytesPerLine();
+        // Tall enough bands that the rows each one first sums stay cheap
+        forEachBand(rowEnd - rowBegin, std::max(16, 4 * (2 * radius + 1)), [&](int bandBegin, int bandEnd) {
+            boxPassRows<Channels>(in, inBpl, out, outBpl, img.width(), img.height(), radius,
+                                  rowBegin + bandBegin, rowBegin + bandEnd);
+        });
+        img.swap(tmp);
+    }
+    return img.copy(target.translated(-grown.topLeft()));
+}
+
+// Every block of the grid at the image origin that overlaps `target` is
+// averaged over all its pixels and painted over its part of the target.
+template <int Channels>
+QImage pixelateRegion(const QImage &src, const QRect &target, int block)
+{
+    QImage dst(target.size(), src.format());
+    // Taken once: scanLine() may detach, which is not safe across bands
+    uchar *dstBits = dst.bits();
+    const qsizetype dstBpl = dst.bytesPerLine();
+    const int bx0 = target.left() / block;
+    const int bx1 = target.right() / block;
+    const int by0 = target.top() / block;
+    const int by1 = target.bottom() / block;
+
+    forEachBand(by1 - by0 + 1, 1, [&](int bandBegin, int bandEnd) {
+        for (int by = by0 + bandBegin; by < by0 + bandEnd; ++by) {
+            const int y0 = by * block;
+            const int y1 = std::min(src.height(), y0 + block);
+            for (int bx = bx0; bx <= bx1; ++bx) {
+                const int x0 = bx * block;
+                const int x1 = std::min(src.width(), x0 + block);
+
+                quint64 sum[Channels] = {};
+                for (int y = y0; y < y1; ++y) {
+                    const uchar *line = src.constScanLine(y) + qsizetype(x0) * Channels;
+                    for (int i = 0; i < (x1 - x0) * Channels; i += Channels)
+                        for (int c = 0; c < Channels; ++c)
+                            sum[c] += line[i + c];
+                }
+                const quint64 count = quint64(x1 - x0) * quint64(y1 - y0);
+                uchar mean[Channels];
+                for (int c = 0; c < Channels; ++c)
+                    mean[c] = uchar((sum[c] + count / 2) / count);
+
+                const int left = std::max(x0, target.left()) - target.left();
+                const int right = std::min(x1, target.right() + 1) - target.left();
+                const int top = std::max(y0, target.top()) - target.top();
+                const int bottom = std::min(y1, target.bottom() + 1) - target.top();
+                for (int y = top; y < bottom; ++y) {
+                    uchar *line = dstBits + y * dstBpl;
+                    for (int x = left; x < right; ++x)
+                        std::memcpy(line + qsizetype(x) * Channels, mean, Channels);
+                }
+            }
+        }
+    });
+    return dst;
+}
+
+// The colour is encoded once through a 1x1 image of the same format, which
+// takes care of premultiplication, channel order and grey conversion.
+template <int Channels>
+QImage fillRegion(const QImage &src, const QRect &target, const QColor &color)
+{
+    QImage pixel(1, 1, src.format());
+    pixel.setPixelColor(0, 0, color);
+    uchar value[Channels];
+    std::memcpy(value, pixel.constScanLine(0), Channels);
+
+    QImage dst(target.size(), src.format());
+    for (int y = 0; y < dst.height(); ++y) {
+        uchar *line = dst.scanLine(y);
+        for (int x = 0; x < dst.width(); ++x)
+            std::memcpy(line + qsizetype(x) * Channels, value, Channels);
+    }
+    return dst;
+}
+
+template <int Channels>
+QImage redactRegion(const QImage &src, const QRect &target, const RedactionKernel &kernel)
+{
+    switch (kernel.method) {
+    case RedactionMethod::Box:
+        if (kernel.radius <= 0)
+            return src.copy(target);
+        return boxBlurPasses<Channels>(src, target, { kernel.radius });
+    case RedactionMethod::Gaussian:
+        if (kernel.radius <= 0)
+            return src.copy(target);
+        return boxBlurPasses<Channels>(src, target, gaussianBoxRadii(kernel.radius / 2.0));
+    case RedactionMethod::Pixelate:
+        return pixelateRegion<Channels>(src, target, std::max(1, 2 * kernel.radius));
+    case RedactionMethod::SolidFill:
+        return fillRegion<Channels>(src, target, kernel.color);
+    }
+    return src.copy(target);
+}
+
+} // namespace
+
+bool parseRedactionMethod(const QString &name, RedactionMethod *method)
+{
+    const QString key = name.trimmed().toLower();
+    RedactionMethod parsed;
+    if (key == QLatin1String("box"))
+        parsed = RedactionMethod::Box;
+    else if (key == QLatin1String("gaussian"))
+        parsed = RedactionMethod::Gaussian;
+    else if (key == QLatin1String("pixelate"))
+        parsed = RedactionMethod::Pixelate;
+    else if (key == QLatin1String("fill"))
+        parsed = RedactionMethod::SolidFill;
+    else
+        return false;
+
+    if (method)
+        *method = parsed;
+    return true;
+}
+
+QString redactionMethodName(RedactionMethod method)
+{
+    switch (method) {
+    case RedactionMethod::Box:       return QStringLiteral("box");
+    case RedactionMethod::Gaussian:  return QStringLiteral("gaussian");
+    case RedactionMethod::Pixelate:  return QStringLiteral("pixelate");
+    case RedactionMethod::SolidFill: return QStringLiteral("fill");
+    }
+    return QString();
+}
+
+int redactionReach(const RedactionKernel &kernel)
+{
+    switch (kernel.method) {
+    case RedactionMethod::Box:
+        return std::max(0, kernel.radius);
+    case RedactionMethod::Gaussian: {
+        if (kernel.radius <= 0)
+            return 0;
+        int reach = 0;
+        for (int r : gaussianBoxRadii(kernel.radius / 2.0))
+            reach += r;
+        return reach;
+    }
+    case RedactionMethod::Pixelate:
+        return std::max(1, 2 * kernel.radius) - 1;
+    case RedactionMethod::SolidFill:
+        return 0;
+    }
+    return 0;
+}
+
+QImage applyRedaction(const QImage &src, const QRect &rect, const RedactionKernel &kernel)
+{
+    const QRect target = rect & src.rect();
+    if (target.isEmpty())
+        return QImage();
+
+    switch (src.format()) {
+    case QImage::Format_ARGB32:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return redactRegion<4>(src, target, kernel);
+    case QImage::Format_RGB888:
+        return redactRegion<3>(src, target, kernel);
+    case QImage::Format_Grayscale8:
+        return redactRegion<1>(src, target, kernel);
+    default:
+        return redactRegion<4>(src.convertToFormat(QImage::Format_ARGB32_Premultiplied), target, kernel);
+    }
+}
@@ -0,0 +1,78 @@
+#include "ScaledBlur.h"
+#include "BandParallel.h"
+#include "BoxBlur.h"
+
+#include <algorithm>
+
+namespace {
+
+// Output rows per band when halving.
+constexpr int kHalveBandRows = 32;
+
+} // namespace
+
+int blurScaleFactor(int radius)
+{
+    int factor = 1;
+    if (radius <= kFullResolutionBlurRadius)
+        return factor;
+    while (radius > factor * (kFullResolutionBlurRadius / 2))
+        factor *= 2;
+    return factor;
+}
+
+QImage halveImage(const QImage &img)
+{
+    // Opaque RGB32 already is premultiplied; read it in place
+    const QImage in = img.format() == QImage::Format_RGB32
+                          ? img
+                          : img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const int w = in.width();
+    const int h = in.height();
+    QImage out((w + 1) / 2, (h + 1) / 2, QImage::Format_ARGB32_Premultiplied);
+    uchar *outBits = out.bits();
+    const qsizetype outBpl = out.bytesPerLine();
+
+    forEachBand(out.height(), kHalveBandRows, [&](int rowBegin, int rowEnd) {
+        for (int oy = rowBegin; oy < rowEnd; ++oy) {
+            const uchar *top = in.constScanLine(2 * oy);
+            const uchar *bottom = in.constScanLine(std::min(h - 1, 2 * oy + 1));
+            const int rows = 2 * oy + 1 < h ? 2 : 1;
+            uchar *outLine = outBits + oy * outBpl;
+
+            for (int ox = 0; ox < out.width(); ++ox) {
+                const int x0 = 2 * ox;
+                const int x1 = std::min(w - 1, x0 + 1);
+                const int count = rows * (x1 - x0 + 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = top[4 * x0 + c] + (x1 > x0 ? top[4 * x1 + c] : 0);
+                    if (rows == 2)
+                        sum += bottom[4 * x0 + c] + (x1 > x0 ? bottom[4 * x1 + c] : 0);
+                    outLine[4 * ox + c] = uchar((sum + count / 2) / count);
+                }
+            }
+        }
+    });
+    return out;
+}
+
+QImage scaledBoxBlurRegion(const QImage &reduced, int factor, const QSize &fullSize,
+                           const QRect &rect, int radius)
+{
+    const QRect target = rect & QRect(QPoint(0, 0), fullSize);
+    if (target.isEmpty())
+        return QImage();
+
+    // Reduced pixels under the target, plus one on each side for the
+    // bilinear taps
+    const QRect targetCells(QPoint(target.left() / factor, target.top() / factor),
+                            QPoint(target.right() / factor, target.bottom() / factor));
+    const QRect cells = targetCells.adjusted(-1, -1, 1, 1) & reduced.rect();
+
+    const int smallRadius = std::max(1, (radius + factor / 2) / factor);
+    const QImage small = boxBlurRegion(reduced, cells, smallRadius);
+
+    const QImage up = small.scaled(small.size() * factor, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                          .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    return up.copy(target.translated(-cells.topLeft() * factor));
+}
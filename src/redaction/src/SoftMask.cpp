@@ -0,0 +1,238 @@
+#include "SoftMask.h"
+#include "BandParallel.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Rows per band when converting or combining, which do little work per pixel.
+constexpr int kSoftMaskBandRows = 64;
+
+// round(x / 255) for x <= 255 * 255
+inline uint divide255(uint x)
+{
+    return ((x + 128) * 257) >> 16;
+}
+
+// Coverage of bit `bit` of a word, given the index of the word's first edge
+// pixel
+inline uint coverageInWord(quint64 bits, quint64 edge, const std::vector<uchar> &values,
+                           qsizetype index, int bit)
+{
+    const quint64 mask = quint64(1) << bit;
+    if (edge & mask)
+        return values[size_t(index + qPopulationCount(edge & (mask - 1)))];
+    return (bits & mask) ? 255 : 0;
+}
+
+} // namespace
+
+SoftMask::SoftMask(const QSize &size)
+    : m_bits(size)
+    , m_edge(size)
+    , m_rowStart(size_t(std::max(0, m_bits.height())) + 1, 0)
+{
+}
+
+SoftMask SoftMask::fromImage(const QImage &mask)
+{
+    if (mask.isNull())
+        return SoftMask();
+
+    const bool grey = mask.format() == QImage::Format_Grayscale8;
+    const QImage m = grey || mask.format() == QImage::Format_ARGB32_Premultiplied
+                         ? mask
+                         : mask.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    SoftMask soft(m.size());
+    std::vector<std::vector<uchar>> rowValues(size_t(m.height()));
+    const int w = m.width();
+    forEachBand(m.height(), kSoftMaskBandRows, [&](int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const uchar *greyLine = m.constScanLine(y);
+            const QRgb *line = reinterpret_cast<const QRgb *>(greyLine);
+            quint64 *bits = soft.m_bits.row(y);
+            quint64 *edge = soft.m_edge.row(y);
+            std::vector<uchar> &values = rowValues[size_t(y)];
+            for (int x0 = 0; x0 < w; x0 += 64) {
+                const int n = std::min(64, w - x0);
+                quint64 set = 0;
+                quint64 partial = 0;
+                for (int i = 0; i < n; ++i) {
+                    const int c = grey ? greyLine[x0 + i] : qGray(line[x0 + i]);
+                    set |= quint64(c > 0) << i;
+                    if (c > 0 && c < 255) {
+                        partial |= quint64(1) << i;
+                        values.push_back(uchar(c));
+                    }
+                }
+                bits[x0 >> 6] = set;
+                edge[x0 >> 6] = partial;
+            }
+        }
+    });
+    soft.setEdgeValues(rowValues);
+    return soft;
+}
+
+SoftMask SoftMask::fromRects(const QSize &size, const QVector<QRect> &rects)
+{
+    SoftMask soft(size);
+    for (const QRect &rect : rects)
+        soft.m_bits.fillRect(rect);
+    return soft;
+}
+
+QImage SoftMask::toImage() const
+{
+    if (isNull())
+        return QImage();
+
+    QImage image(size(), QImage::Format_ARGB32_Premultiplied);
+    uchar *bits = image.bits();
+    const qsizetype bpl = image.bytesPerLine();
+    const int w = width();
+    forEachBand(height(), kSoftMaskBandRows, [&](int rowBegin, int rowEnd) {
+        std::vector<uchar> coverage(size_t(w), 0);
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            coverageRow(y, 0, w, coverage.data());
+            QRgb *line = reinterpret_cast<QRgb *>(bits + y * bpl);
+            for (int x = 0; x < w; ++x) {
+                const int c = coverage[size_t(x)];
+                line[x] = qRgba(c, c, c, c);
+            }
+        }
+    });
+    return image;
+}
+
+int SoftMask::coverage(int x, int y) const
+{
+    uchar c;
+    coverageRow(y, x, 1, &c);
+    return c;
+}
+
+qsizetype SoftMask::edgeIndex(int x, int y) const
+{
+    const quint64 *edge = m_edge.row(y);
+    qsizetype index = m_rowStart[size_t(y)];
+    for (int i = 0; i < (x >> 6); ++i)
+        index += qPopulationCount(edge[i]);
+    if (x & 63)
+        index += qPopulationCount(edge[x >> 6] & ((quint64(1) << (x & 63)) - 1));
+    return index;
+}
+
+void SoftMask::coverageRow(int y, int x, int n, uchar *out) const
+{
+    if (n <= 0)
+        return;
+
+    const quint64 *bits = m_bits.row(y);
+    const quint64 *edge = m_edge.row(y);
+    qsizetype index = edgeIndex(x, y);
+    const int end = x + n;
+    while (x < end) {
+        const int word = x >> 6;
+        // Whole words without edge pixels are all in or all out, mostly
+        if ((x & 63) == 0 && end - x >= 64 && edge[word] == 0
+            && (bits[word] == 0 || bits[word] == ~quint64(0))) {
+            std::memset(out, bits[word] ? 255 : 0, 64);
+            out += 64;
+            x += 64;
+            continue;
+        }
+        const quint64 mask = quint64(1) << (x & 63);
+        if (edge[word] & mask)
+            *out++ = m_edgeValues[size_t(index++)];
+        else
+            *out++ = (bits[word] & mask) ? 255 : 0;
+        ++x;
+    }
+}
+
+SoftMask &SoftMask::operator|=(const SoftMask &other)
+{
+    if (isNull() || other.size() != size())
+        return *this;
+    *this = combine(*this, other, Operation::Unite);
+    return *this;
+}
+
+SoftMask &SoftMask::subtract(const SoftMask &other)
+{
+    if (isNull() || other.size() != size())
+        return *this;
+    *this = combine(*this, other, Operation::Subtract);
+    return *this;
+}
+
+// Which pixels are set and which are full follows from the operands' words
+// alone: a union is full where either is, a difference is set where `b` is
+// not full and full where `b` is clear. Only the pixels set but not full
+// need their coverage worked out; a difference can round to zero there,
+// which clears the pixel.
+SoftMask SoftMask::combine(const SoftMask &a, const SoftMask &b, Operation op)
+{
+    SoftMask result(a.size());
+    std::vector<std::vector<uchar>> rowValues(size_t(a.height()));
+    const int wordsPerRow = a.m_bits.wordsPerRow();
+    forEachBand(a.height(), kSoftMaskBandRows, [&](int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const quint64 *aBits = a.m_bits.row(y);
+            const quint64 *aEdge = a.m_edge.row(y);
+            const quint64 *bBits = b.m_bits.row(y);
+            const quint64 *bEdge = b.m_edge.row(y);
+            quint64 *bits = result.m_bits.row(y);
+            quint64 *edge = result.m_edge.row(y);
+            std::vector<uchar> &values = rowValues[size_t(y)];
+            qsizetype aIndex = a.m_rowStart[size_t(y)];
+            qsizetype bIndex = b.m_rowStart[size_t(y)];
+            for (int i = 0; i < wordsPerRow; ++i) {
+                const quint64 aFull = aBits[i] & ~aEdge[i];
+                const quint64 bFull = bBits[i] & ~bEdge[i];
+                quint64 set;
+                quint64 full;
+                if (op == Operation::Unite) {
+                    set = aBits[i] | bBits[i];
+                    full = aFull | bFull;
+                } else {
+                    set = aBits[i] & ~bFull;
+                    full = aFull & ~bBits[i];
+                }
+                quint64 soft = set & ~full;
+                for (quint64 rest = soft; rest; rest &= rest - 1) {
+                    const int bit = int(qCountTrailingZeroBits(rest));
+                    const uint ca = coverageInWord(aBits[i], aEdge[i], a.m_edgeValues, aIndex, bit);
+                    const uint cb = coverageInWord(bBits[i], bEdge[i], b.m_edgeValues, bIndex, bit);
+                    const uint c = op == Operation::Unite ? std::max(ca, cb) : divide255(ca * (255 - cb));
+                    if (c == 0) {
+                        set &= ~(quint64(1) << bit);
+                        soft &= ~(quint64(1) << bit);
+                    } else {
+                        values.push_back(uchar(c));
+                    }
+                }
+                bits[i] = set;
+                edge[i] = soft;
+                aIndex += qPopulationCount(aEdge[i]);
+                bIndex += qPopulationCount(bEdge[i]);
+            }
+        }
+    });
+    result.setEdgeValues(rowValues);
+    return result;
+}
+
+void SoftMask::setEdgeValues(const std::vector<std::vector<uchar>> &rowValues)
+{
+    m_rowStart.assign(rowValues.size() + 1, 0);
+    for (size_t y = 0; y < rowValues.size(); ++y)
+        m_rowStart[y + 1] = m_rowStart[y] + qsizetype(rowValues[y].size());
+    m_edgeValues.resize(size_t(m_rowStart.back()));
+    for (size_t y = 0; y < rowValues.size(); ++y)
+        std::copy(rowValues[y].begin(), rowValues[y].end(), m_edgeValues.begin() + m_rowStart[y]);
+}
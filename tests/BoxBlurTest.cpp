@@ -0,0 +1,329 @@
+// Box blur paths against a brute-force reference, and the region-limited
+// blend against the same blend over the whole image.
+
+#include "BandParallel.h"
+#include "BlurIntegral.h"
+#include "BoxBlur.h"
+#include "MaskBlend.h"
+#include "MaskRegions.h"
+#include "RedactionKernel.h"
+#include "SoftMask.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+
+namespace {
+
+const int kRadii[] = { 1, 2, 5, 17, 200 };
+
+QImage noise(const QSize &size, QImage::Format format, quint32 seed)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    QRandomGenerator rng(seed);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            line[x] = rng.generate();
+    }
+    return image.convertToFormat(format);
+}
+
+// Rounded mean of the straight ARGB32 pixels in the window clipped to the
+// image, premultiplied afterwards: what boxBlur() is specified to return.
+QImage referenceBoxBlur(const QImage &src, int radius)
+{
+    const QImage img = src.convertToFormat(QImage::Format_ARGB32);
+    QImage dst(img.size(), QImage::Format_ARGB32);
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            quint64 sum[4] = {};
+            quint64 count = 0;
+            for (int wy = std::max(0, y - radius); wy <= std::min(img.height() - 1, y + radius); ++wy) {
+                const uchar *line = img.constScanLine(wy);
+                for (int wx = std::max(0, x - radius); wx <= std::min(img.width() - 1, x + radius); ++wx) {
+                    for (int c = 0; c < 4; ++c)
+                        sum[c] += line[4 * wx + c];
+                    ++count;
+                }
+            }
+            uchar *out = dst.scanLine(y) + 4 * x;
+            for (int c = 0; c < 4; ++c)
+                out[c] = uchar((sum[c] + count / 2) / count);
+        }
+    }
+    return dst.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// The same rounded mean taken on each byte as stored, for any pixel size:
+// what Box redaction is specified to return.
+QImage referenceBoxBytes(const QImage &src, int radius)
+{
+    const int bytes = src.depth() / 8;
+    QImage dst(src.size(), src.format());
+    for (int y = 0; y < src.height(); ++y) {
+        for (int x = 0; x < src.width(); ++x) {
+            for (int c = 0; c < bytes; ++c) {
+                quint64 sum = 0;
+                quint64 count = 0;
+                for (int wy = std::max(0, y - radius); wy <= std::min(src.height() - 1, y + radius); ++wy) {
+                    for (int wx = std::max(0, x - radius); wx <= std::min(src.width() - 1, x + radius); ++wx) {
+                        sum += src.constScanLine(wy)[bytes * wx + c];
+                        ++count;
+                    }
+                }
+                dst.scanLine(y)[bytes * x + c] = uchar((sum + count / 2) / count);
+            }
+        }
+    }
+    return dst;
+}
+
+// Rects touching every edge and corner, inside, and a single pixel.
+QVector<QRect> probeRects(const QSize &size)
+{
+    const int w = size.width();
+    const int h = size.height();
+    return {
+        QRect(0, 0, w, h),
+        QRect(0, 0, w / 3 + 1, h / 2 + 1),
+        QRect(w / 2, h / 2, w - w / 2, h - h / 2),
+        QRect(w / 4, 0, w / 2 + 1, 3),
+        QRect(0, h / 3, 5, h / 3 + 1),
+        QRect(w / 3, h / 3, w / 3 + 1, h / 3 + 1),
+        QRect(w - 1, h - 1, 1, 1),
+    };
+}
+
+// Antialiased strokes as the canvas paints them: two ellipses, one across
+// the left edge, and a bar, each pixel covered by the share of its 4x4
+// subsamples inside a shape.
+QImage strokeCoverage(const QSize &size)
+{
+    const auto inside = [](double x, double y) {
+        const auto inEllipse = [&](double cx, double cy, double rx, double ry) {
+            return (x - cx) * (x - cx) / (rx * rx) + (y - cy) * (y - cy) / (ry * ry) <= 1.0;
+        };
+        return inEllipse(-4.5, 30.5, 20.3, 14.7) || inEllipse(100.2, 70.7, 31.1, 22.4)
+               || (x >= 40.5 && x < 100.5 && y >= 95.25 && y < 102.75);
+    };
+
+    QImage coverage(size, QImage::Format_Grayscale8);
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            int hits = 0;
+            for (int sy = 0; sy < 4; ++sy) {
+                for (int sx = 0; sx < 4; ++sx)
+                    hits += inside(x + (sx + 0.5) / 4, y + (sy + 0.5) / 4);
+            }
+            coverage.scanLine(y)[x] = uchar((hits * 255 + 8) / 16);
+        }
+    }
+    return coverage;
+}
+
+// blendByCoverage() over the whole image at once
+QImage referenceBlend(const QImage &original, const QImage &blurred, const QImage &coverage)
+{
+    QImage result = original;
+    for (int y = 0; y < result.height(); ++y)
+        blendRow(reinterpret_cast<QRgb *>(result.scanLine(y)),
+                 reinterpret_cast<const QRgb *>(blurred.constScanLine(y)),
+                 coverage.constScanLine(y), result.width());
+    return result;
+}
+
+} // namespace
+
+class BoxBlurTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void wholeImageMatchesReference();
+    void regionMatchesWholeImage();
+    void integralMatchesRegion();
+    void boxRedactionMatchesRegion();
+    void boxRedactionMatchesReference();
+    void gaussianRegionMatchesWholeImage();
+    void regionBlendMatchesWholeImage();
+    void featheredCoverageMatchesWholeMask();
+};
+
+// Several bands even on a single core, so band edges are exercised
+void BoxBlurTest::initTestCase()
+{
+    setRedactionThreadCount(4);
+}
+
+void BoxBlurTest::cleanupTestCase()
+{
+    setRedactionThreadCount(0);
+}
+
+void BoxBlurTest::wholeImageMatchesReference()
+{
+    // Odd widths run the SIMD loops into their scalar tails
+    const QSize sizes[] = { QSize(1, 1), QSize(1, 23), QSize(37, 1), QSize(37, 29), QSize(64, 33) };
+    const QImage::Format formats[] = { QImage::Format_ARGB32, QImage::Format_RGB32,
+                                       QImage::Format_ARGB32_Premultiplied, QImage::Format_RGB888,
+                                       QImage::Format_Grayscale8 };
+    quint32 seed = 1;
+    for (const QSize &size : sizes) {
+        for (QImage::Format format : formats) {
+            const QImage src = noise(size, format, seed++);
+            for (int radius : kRadii) {
+                QVERIFY2(boxBlur(src, radius) == referenceBoxBlur(src, radius),
+                         qPrintable(QString("%1x%2 format %3 radius %4")
+                                        .arg(size.width()).arg(size.height()).arg(int(format)).arg(radius)));
+            }
+        }
+    }
+}
+
+void BoxBlurTest::regionMatchesWholeImage()
+{
+    const QImage::Format formats[] = { QImage::Format_ARGB32, QImage::Format_ARGB32_Premultiplied,
+                                       QImage::Format_RGB888 };
+    quint32 seed = 100;
+    for (QImage::Format format : formats) {
+        const QImage src = noise(QSize(53, 41), format, seed++);
+        for (int radius : kRadii) {
+            const QImage full = boxBlur(src, radius);
+            for (const QRect &rect : probeRects(src.size())) {
+                QVERIFY2(boxBlurRegion(src, rect, radius) == full.copy(rect),
+                         qPrintable(QString("format %1 radius %2 rect %3,%4 %5x%6")
+                                        .arg(int(format)).arg(radius).arg(rect.x()).arg(rect.y())
+                                        .arg(rect.width()).arg(rect.height())));
+            }
+        }
+    }
+}
+
+void BoxBlurTest::integralMatchesRegion()
+{
+    const QImage src = noise(QSize(300, 270), QImage::Format_ARGB32, 200);
+    BlurIntegral integral(src);
+    for (int radius : { 1, 5, 17, 32 }) {
+        for (const QRect &rect : probeRects(src.size()))
+            QVERIFY2(integral.blurRegion(rect, radius) == boxBlurRegion(src, rect, radius),
+                     qPrintable(QString("radius %1").arg(radius)));
+    }
+}
+
+void BoxBlurTest::boxRedactionMatchesRegion()
+{
+    const QImage src = noise(QSize(45, 38), QImage::Format_ARGB32, 300);
+    RedactionKernel kernel;
+    kernel.method = RedactionMethod::Box;
+    for (int radius : kRadii) {
+        kernel.radius = radius;
+        for (const QRect &rect : probeRects(src.size()))
+            QCOMPARE(applyRedaction(src, rect, kernel).convertToFormat(QImage::Format_ARGB32_Premultiplied),
+                     boxBlurRegion(src, rect, radius));
+    }
+}
+
+// Every pixel size is averaged as stored, with no conversion
+void BoxBlurTest::boxRedactionMatchesReference()
+{
+    const QImage::Format formats[] = { QImage::Format_ARGB32_Premultiplied, QImage::Format_RGB888,
+                                       QImage::Format_Grayscale8 };
+    quint32 seed = 310;
+    RedactionKernel kernel;
+    kernel.method = RedactionMethod::Box;
+    for (QImage::Format format : formats) {
+        const QImage src = noise(QSize(37, 29), format, seed++);
+        for (int radius : kRadii) {
+            kernel.radius = radius;
+            const QImage expected = referenceBoxBytes(src, radius);
+            for (const QRect &rect : probeRects(src.size())) {
+                QVERIFY2(applyRedaction(src, rect, kernel) == expected.copy(rect),
+                         qPrintable(QString("format %1 radius %2").arg(int(format)).arg(radius)));
+            }
+        }
+    }
+}
+
+// The stacked passes cut their rows short of the grown rect; the target
+// must not see it. Radius 1 is the smallest Gaussian and must still blur.
+void BoxBlurTest::gaussianRegionMatchesWholeImage()
+{
+    const QImage::Format formats[] = { QImage::Format_ARGB32, QImage::Format_RGB888,
+                                       QImage::Format_Grayscale8 };
+    quint32 seed = 320;
+    RedactionKernel kernel;
+    kernel.method = RedactionMethod::Gaussian;
+    for (QImage::Format format : formats) {
+        const QImage src = noise(QSize(53, 41), format, seed++);
+        for (int radius : { 1, 2, 5, 17, 60 }) {
+            kernel.radius = radius;
+            const QImage full = applyRedaction(src, src.rect(), kernel);
+            QCOMPARE(full.format(), src.format());
+            QVERIFY(full != src);
+            for (const QRect &rect : probeRects(src.size())) {
+                QVERIFY2(applyRedaction(src, rect, kernel) == full.copy(rect),
+                         qPrintable(QString("format %1 radius %2").arg(int(format)).arg(radius)));
+            }
+        }
+    }
+}
+
+// What applyFakeBlur() does: blur only the mask's regions and blend them by
+// coverage. Outside the regions coverage is zero, so the result must equal
+// blurring and blending the whole image.
+void BoxBlurTest::regionBlendMatchesWholeImage()
+{
+    const QSize size(160, 120);
+    const QImage original = noise(size, QImage::Format_ARGB32_Premultiplied, 400);
+
+    const QImage coverage = strokeCoverage(size);
+    const SoftMask mask = SoftMask::fromImage(coverage);
+    const QVector<QRect> regions = maskRegions(mask.bits());
+    QVERIFY(!regions.isEmpty());
+
+    for (int radius : { 2, 9, 25 }) {
+        const QImage expected = referenceBlend(original, boxBlur(original, radius), coverage);
+
+        QImage result = original;
+        for (const QRect &rect : regions)
+            blendByCoverage(result, boxBlurRegion(original, rect, radius), mask, rect, 0);
+        QVERIFY2(result == expected, qPrintable(QString("radius %1").arg(radius)));
+    }
+
+    // A feathered blend is the same blend by the feathered coverage
+    const int feather = 5;
+    const QImage blurred = boxBlur(original, 9);
+    const QImage featheredCoverage = maskCoverage(mask, QRect(QPoint(0, 0), size), feather);
+    QImage result = original;
+    for (const QRect &rect : regions)
+        blendByCoverage(result, blurred.copy(rect), mask, rect, feather);
+    QVERIFY(result == referenceBlend(original, blurred, featheredCoverage));
+}
+
+// The feather reads coverage around each region, so a region must see the
+// same edge as the whole mask does, and never exceed the mask.
+void BoxBlurTest::featheredCoverageMatchesWholeMask()
+{
+    const QSize size(160, 120);
+    const QImage coverage = strokeCoverage(size);
+    const SoftMask mask = SoftMask::fromImage(coverage);
+    for (int feather : { 2, 7 }) {
+        const QImage whole = maskCoverage(mask, QRect(QPoint(0, 0), size), feather);
+        for (const QRect &rect : probeRects(size))
+            QVERIFY2(maskCoverage(mask, rect, feather) == whole.copy(rect),
+                     qPrintable(QString("feather %1").arg(feather)));
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x)
+                QVERIFY(whole.constScanLine(y)[x] <= coverage.constScanLine(y)[x]);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(BoxBlurTest)
+
+#include "BoxBlurTest.moc"
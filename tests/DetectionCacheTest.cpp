@@ -0,0 +1,245 @@
+// Content hashing and the on-disk detection cache: known XXH64 values,
+// pixel hashes that ignore scanline padding, and cache files that survive a
+// reopen, a torn append and an incompatible header.
+
+#include "ContentHash.h"
+#include "DetectionCache.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cstring>
+
+namespace {
+
+DetectionResult detection(int x, int y, int w, int h, float confidence, int classId)
+{
+    DetectionResult r;
+    r.box = QRect(x, y, w, h);
+    r.confidence = confidence;
+    r.classId = classId;
+    return r;
+}
+
+bool sameResults(const std::vector<DetectionResult> &a, const std::vector<DetectionResult> &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const DetectionResult &x, const DetectionResult &y) {
+                          return x.box == y.box && x.confidence == y.confidence && x.classId == y.classId;
+                      });
+}
+
+bool writeFile(const QString &path, const QByteArray &bytes)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    return file.write(bytes) == bytes.size();
+}
+
+// Bytes appended to whatever is there, as a crash mid-append leaves them
+bool appendBytes(const QString &path, int count)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+    file.seek(file.size());
+    QDataStream out(&file);
+    for (int i = 0; i < count; ++i)
+        out << quint32(0xabcdef01u);
+    return true;
+}
+
+} // namespace
+
+class DetectionCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void xxh64KnownValues();
+    void pixelHashIgnoresPadding();
+    void entriesSurviveReopen();
+    void tornTailKeepsEarlierRecords();
+    void incompatibleFileIsReplaced();
+    void compactionKeepsNewestEntries();
+    void modelKeyFollowsContentAndSettings();
+};
+
+// Reference values from the xxHash distribution
+void DetectionCacheTest::xxh64KnownValues()
+{
+    QCOMPARE(xxh64(nullptr, 0), Q_UINT64_C(0xEF46DB3751D8E999));
+    QCOMPARE(xxh64("a", 1), Q_UINT64_C(0xD24EC4F1A98C6E5B));
+    QCOMPARE(xxh64("abc", 3), Q_UINT64_C(0x44BC2CF5AD770999));
+    const char *longer = "Nobody inspects the spammish repetition"; // past the 32-byte stripes
+    QCOMPARE(xxh64(longer, std::strlen(longer)), Q_UINT64_C(0xFBCEA83C8A378BF1));
+    QVERIFY(xxh64("abc", 3, 1) != xxh64("abc", 3));
+}
+
+// RGB888 rows of odd width are padded to 32 bits; what the padding holds
+// must not change the hash, and the geometry must.
+void DetectionCacheTest::pixelHashIgnoresPadding()
+{
+    QImage a(QSize(13, 7), QImage::Format_RGB888);
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width() * 3; ++x)
+            a.scanLine(y)[x] = uchar(7 * x + 31 * y);
+    }
+    QVERIFY(a.bytesPerLine() > a.width() * 3);
+
+    QImage b = a.copy();
+    for (int y = 0; y < b.height(); ++y) {
+        uchar *line = b.scanLine(y);
+        for (qsizetype x = b.width() * 3; x < b.bytesPerLine(); ++x)
+            line[x] = uchar(0xa5 ^ x ^ y);
+    }
+    QCOMPARE(hashImagePixels(a), hashImagePixels(b));
+
+    b.scanLine(3)[5] ^= 1;
+    QVERIFY(hashImagePixels(a) != hashImagePixels(b));
+
+    // The same bytes at another geometry or in another format differ
+    QImage wide(QSize(16, 4), QImage::Format_ARGB32);
+    wide.fill(0);
+    QImage tall(QSize(4, 16), QImage::Format_ARGB32);
+    tall.fill(0);
+    QVERIFY(hashImagePixels(wide) != hashImagePixels(tall));
+    QVERIFY(hashImagePixels(wide) != hashImagePixels(wide.convertToFormat(QImage::Format_RGB32)));
+    QVERIFY(hashImagePixels(QImage()) == hashImagePixels(QImage()));
+}
+
+void DetectionCacheTest::entriesSurviveReopen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("nested/detections.bin");
+
+    const std::vector<DetectionResult> first = { detection(10, 20, 30, 40, 0.9f, 0),
+                                                 detection(-5, 0, 12, 7, 0.31f, 3) };
+    const std::vector<DetectionResult> second = { detection(1, 2, 3, 4, 0.5f, 1) };
+    {
+        DetectionCache cache(path);
+        std::vector<DetectionResult> results;
+        QVERIFY(!cache.lookup(1, 100, &results));
+        cache.insert(1, 100, first);
+        cache.insert(2, 100, {});
+        cache.insert(1, 200, second);
+        QVERIFY(cache.lookup(1, 100, &results));
+        QVERIFY(sameResults(results, first));
+    }
+
+    DetectionCache reopened(path);
+    std::vector<DetectionResult> results;
+    QVERIFY(reopened.lookup(1, 100, &results));
+    QVERIFY(sameResults(results, first));
+    QVERIFY(reopened.lookup(2, 100, &results));
+    QVERIFY(results.empty());
+    QVERIFY(reopened.lookup(1, 200, &results));
+    QVERIFY(sameResults(results, second));
+    QVERIFY(!reopened.lookup(2, 200, &results));
+
+    // A later record for the same key wins
+    reopened.insert(1, 100, second);
+    DetectionCache again(path);
+    QVERIFY(again.lookup(1, 100, &results));
+    QVERIFY(sameResults(results, second));
+}
+
+void DetectionCacheTest::tornTailKeepsEarlierRecords()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath("detections.bin");
+    const std::vector<DetectionResult> boxes = { detection(5, 6, 7, 8, 0.75f, 2) };
+    {
+        DetectionCache cache(path);
+        cache.insert(1, 1, boxes);
+        cache.insert(2, 1, boxes);
+    }
+    QVERIFY(appendBytes(path, 3));
+
+    std::vector<DetectionResult> results;
+    {
+        DetectionCache cache(path);
+        QVERIFY(cache.lookup(1, 1, &results));
+        QVERIFY(cache.lookup(2, 1, &results));
+        QVERIFY(sameResults(results, boxes));
+        cache.insert(3, 1, boxes); // rewrites the file without the torn bytes
+    }
+
+    DetectionCache reopened(path);
+    for (quint64 image : { 1, 2, 3 })
+        QVERIFY(reopened.lookup(image, 1, &results));
+}
+
+void DetectionCacheTest::incompatibleFileIsReplaced()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath("detections.bin");
+    QVERIFY(writeFile(path, QByteArray("not a cache file")));
+
+    const std::vector<DetectionResult> boxes = { detection(0, 0, 1, 1, 0.5f, 0) };
+    std::vector<DetectionResult> results;
+    {
+        DetectionCache cache(path);
+        QVERIFY(!cache.lookup(1, 1, &results));
+        cache.insert(1, 1, boxes);
+    }
+    DetectionCache reopened(path);
+    QVERIFY(reopened.lookup(1, 1, &results));
+    QVERIFY(sameResults(results, boxes));
+}
+
+// The file is rewritten once it holds twice the limit; the newest entries
+// always survive and the oldest are gone after a rewrite.
+void DetectionCacheTest::compactionKeepsNewestEntries()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath("detections.bin");
+    const int limit = 3;
+    {
+        DetectionCache cache(path);
+        cache.setMaxEntries(limit);
+        for (quint64 image = 1; image <= 10; ++image)
+            cache.insert(image, 7, { detection(int(image), 0, 1, 1, 0.5f, 0) });
+    }
+
+    DetectionCache reopened(path);
+    std::vector<DetectionResult> results;
+    for (quint64 image = 8; image <= 10; ++image) {
+        QVERIFY2(reopened.lookup(image, 7, &results), qPrintable(QString("image %1").arg(image)));
+        QCOMPARE(results.front().box.x(), int(image));
+    }
+    for (quint64 image = 1; image <= 4; ++image)
+        QVERIFY2(!reopened.lookup(image, 7, &results), qPrintable(QString("image %1").arg(image)));
+    // Header, then records of 20 bytes plus 24 per box
+    QVERIFY(QFileInfo(path).size() <= 8 + 2 * limit * (20 + 24));
+}
+
+void DetectionCacheTest::modelKeyFollowsContentAndSettings()
+{
+    QTemporaryDir dir;
+    const QString model = dir.filePath("model.onnx");
+    QVERIFY(writeFile(model, QByteArray("weights v1")));
+
+    DetectionCache cache(dir.filePath("detections.bin"));
+    const quint64 key = cache.modelKey(model, "conf=0.25");
+    QCOMPARE(cache.modelKey(model, "conf=0.25"), key);
+    QVERIFY(cache.modelKey(model, "conf=0.30") != key);
+
+    // Replaced by a different file: everything it produced is invalid
+    QVERIFY(writeFile(model, QByteArray("weights v2, retrained")));
+    QVERIFY(cache.modelKey(model, "conf=0.25") != key);
+
+    // A missing file still gives a key for the settings
+    const QString missing = dir.filePath("missing.onnx");
+    QCOMPARE(cache.modelKey(missing, "conf=0.25"), cache.modelKey(missing, "conf=0.25"));
+}
+
+QTEST_APPLESS_MAIN(DetectionCacheTest)
+
+#include "DetectionCacheTest.moc"
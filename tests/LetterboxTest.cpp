@@ -0,0 +1,151 @@
+// letterboxToTensor() against a scalar bilinear resize in double precision.
+
+#include "Letterbox.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+QImage noise(const QSize &size, QImage::Format format, quint32 seed)
+{
+    QImage image(size, QImage::Format_RGB32);
+    QRandomGenerator rng(seed);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x)
+            line[x] = rng.generate() | 0xff000000u;
+    }
+    return image.convertToFormat(format);
+}
+
+// cv2.resize INTER_LINEAR taps for output position i
+void tap(int i, int srcLen, int dstLen, int *lo, int *hi, double *w)
+{
+    const double s = std::max(0.0, (i + 0.5) * srcLen / dstLen - 0.5);
+    *lo = std::min(int(s), srcLen - 1);
+    *hi = std::min(*lo + 1, srcLen - 1);
+    *w = s - *lo;
+}
+
+// Planar RGB in [0, 1] of `image` placed at (padX, padY), newW x newH, on
+// a grey dstW x dstH canvas
+std::vector<float> reference(const QImage &image, int dstW, int dstH, int padX, int padY, int newW, int newH)
+{
+    const size_t plane = size_t(dstW) * dstH;
+    std::vector<float> out(3 * plane, kLetterboxPadValue);
+    for (int y = 0; y < newH; ++y) {
+        int y0, y1;
+        double wy;
+        tap(y, image.height(), newH, &y0, &y1, &wy);
+        for (int x = 0; x < newW; ++x) {
+            int x0, x1;
+            double wx;
+            tap(x, image.width(), newW, &x0, &x1, &wx);
+            const QRgb p[4] = { image.pixel(x0, y0), image.pixel(x1, y0), image.pixel(x0, y1), image.pixel(x1, y1) };
+            const auto sample = [&](int (*channel)(QRgb)) {
+                const double top = channel(p[0]) + wx * (channel(p[1]) - channel(p[0]));
+                const double bottom = channel(p[2]) + wx * (channel(p[3]) - channel(p[2]));
+                return float((top + wy * (bottom - top)) / 255.0);
+            };
+            const size_t i = size_t(padY + y) * dstW + size_t(padX + x);
+            out[i] = sample(qRed);
+            out[plane + i] = sample(qGreen);
+            out[2 * plane + i] = sample(qBlue);
+        }
+    }
+    return out;
+}
+
+// Index of the first value further than `tolerance` from the reference, or -1
+qsizetype firstMismatch(const std::vector<float> &values, const std::vector<float> &expected, float tolerance)
+{
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (std::abs(values[i] - expected[i]) > tolerance)
+            return qsizetype(i);
+    }
+    return -1;
+}
+
+} // namespace
+
+class LetterboxTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesReference();
+    void sameSizeIsExact();
+    void nullImageIsAllPadding();
+};
+
+void LetterboxTest::matchesReference()
+{
+    struct Case { QSize image; QImage::Format format; int dstW; int dstH; };
+    const Case cases[] = {
+        { QSize(1280, 720), QImage::Format_RGB32, 640, 640 },              // landscape, bars above and below
+        { QSize(300, 901), QImage::Format_ARGB32, 640, 640 },              // portrait, bars at the sides
+        { QSize(97, 61), QImage::Format_ARGB32_Premultiplied, 320, 256 },  // upscaled
+        { QSize(1, 1), QImage::Format_RGB32, 64, 64 },
+        { QSize(203, 157), QImage::Format_RGB888, 160, 160 },              // converted first
+    };
+    quint32 seed = 1;
+    for (const Case &c : cases) {
+        const QImage image = noise(c.image, c.format, seed++);
+        std::vector<float> tensor(size_t(3) * c.dstW * c.dstH, -1.0f);
+        const LetterboxTransform lb = letterboxToTensor(image, c.dstW, c.dstH, tensor.data());
+
+        const QString name = QString("%1x%2 into %3x%4").arg(c.image.width()).arg(c.image.height())
+                                 .arg(c.dstW).arg(c.dstH);
+        const float scale = std::min(c.dstW / float(c.image.width()), c.dstH / float(c.image.height()));
+        QVERIFY2(lb.scale == scale, qPrintable(name));
+        const int newW = std::clamp(int(std::lround(c.image.width() * scale)), 1, c.dstW);
+        const int newH = std::clamp(int(std::lround(c.image.height() * scale)), 1, c.dstH);
+        QCOMPARE(lb.padX, (c.dstW - newW) / 2);
+        QCOMPARE(lb.padY, (c.dstH - newH) / 2);
+
+        const std::vector<float> expected = reference(image, c.dstW, c.dstH, lb.padX, lb.padY, newW, newH);
+        const qsizetype bad = firstMismatch(tensor, expected, 1e-4f);
+        QVERIFY2(bad < 0, qPrintable(QString("%1: value %2 is %3, expected %4").arg(name).arg(bad)
+                                         .arg(bad < 0 ? 0.0f : tensor[size_t(bad)])
+                                         .arg(bad < 0 ? 0.0f : expected[size_t(bad)])));
+    }
+}
+
+// Every tap lands on a pixel centre with zero weight on its neighbour
+void LetterboxTest::sameSizeIsExact()
+{
+    const QImage image = noise(QSize(67, 45), QImage::Format_RGB32, 50);
+    std::vector<float> tensor(size_t(3) * 67 * 45);
+    const LetterboxTransform lb = letterboxToTensor(image, 67, 45, tensor.data());
+    QCOMPARE(lb.scale, 1.0f);
+    QCOMPARE(lb.padX, 0);
+    QCOMPARE(lb.padY, 0);
+
+    const size_t plane = size_t(67) * 45;
+    for (int y = 0; y < 45; ++y) {
+        for (int x = 0; x < 67; ++x) {
+            const QRgb p = image.pixel(x, y);
+            const size_t i = size_t(y) * 67 + size_t(x);
+            QCOMPARE(tensor[i], qRed(p) * (1.0f / 255.0f));
+            QCOMPARE(tensor[plane + i], qGreen(p) * (1.0f / 255.0f));
+            QCOMPARE(tensor[2 * plane + i], qBlue(p) * (1.0f / 255.0f));
+        }
+    }
+}
+
+void LetterboxTest::nullImageIsAllPadding()
+{
+    std::vector<float> tensor(size_t(3) * 32 * 16, -1.0f);
+    const LetterboxTransform lb = letterboxToTensor(QImage(), 32, 16, tensor.data());
+    QCOMPARE(lb.scale, 1.0f);
+    QVERIFY(std::all_of(tensor.cbegin(), tensor.cend(), [](float v) { return v == kLetterboxPadValue; }));
+}
+
+QTEST_APPLESS_MAIN(LetterboxTest)
+
+#include "LetterboxTest.moc"
@@ -0,0 +1,167 @@
+// maskRegions() against the properties it promises, checked pixel by pixel.
+
+#include "BitMask.h"
+#include "MaskRegions.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+
+namespace {
+
+// Scattered blobs of a few pixels to a few cells across, some touching the
+// image edges, and stray single pixels between them.
+BitMask randomBlobs(const QSize &size, quint32 seed)
+{
+    QImage image(size, QImage::Format_Grayscale8);
+    image.fill(0);
+    QRandomGenerator rng(seed);
+    const int blobs = 1 + rng.bounded(8);
+    for (int b = 0; b < blobs; ++b) {
+        const int cx = rng.bounded(size.width());
+        const int cy = rng.bounded(size.height());
+        const int rx = 1 + rng.bounded(3 * kMaskCellSize);
+        const int ry = 1 + rng.bounded(2 * kMaskCellSize);
+        for (int y = std::max(0, cy - ry); y <= std::min(size.height() - 1, cy + ry); ++y) {
+            for (int x = std::max(0, cx - rx); x <= std::min(size.width() - 1, cx + rx); ++x) {
+                const double dx = double(x - cx) / rx;
+                const double dy = double(y - cy) / ry;
+                if (dx * dx + dy * dy <= 1.0)
+                    image.scanLine(y)[x] = 255;
+            }
+        }
+    }
+    for (int i = 0; i < 20; ++i)
+        image.scanLine(rng.bounded(size.height()))[rng.bounded(size.width())] = 255;
+    return BitMask::fromImage(image);
+}
+
+bool rowHasBit(const BitMask &mask, int y, int left, int right)
+{
+    for (int x = left; x <= right; ++x) {
+        if (mask.testBit(x, y))
+            return true;
+    }
+    return false;
+}
+
+bool columnHasBit(const BitMask &mask, int x, int top, int bottom)
+{
+    for (int y = top; y <= bottom; ++y) {
+        if (mask.testBit(x, y))
+            return true;
+    }
+    return false;
+}
+
+// Empty if the regions keep every promise, else what they break
+QString checkRegions(const BitMask &mask, const QVector<QRect> &regions)
+{
+    const QRect bounds(QPoint(0, 0), mask.size());
+    for (int i = 0; i < regions.size(); ++i) {
+        const QRect &r = regions[i];
+        if (r.isEmpty() || !bounds.contains(r))
+            return QString("region %1 empty or outside the mask").arg(i);
+        for (int j = i + 1; j < regions.size(); ++j) {
+            if (r.intersects(regions[j]))
+                return QString("regions %1 and %2 overlap").arg(i).arg(j);
+        }
+        // Tight: every edge of the rect has a set pixel on it
+        if (!rowHasBit(mask, r.top(), r.left(), r.right()) || !rowHasBit(mask, r.bottom(), r.left(), r.right())
+            || !columnHasBit(mask, r.left(), r.top(), r.bottom())
+            || !columnHasBit(mask, r.right(), r.top(), r.bottom()))
+            return QString("region %1 is not tight").arg(i);
+    }
+
+    // Non-overlapping, so "in one" is "in exactly one"
+    for (int y = 0; y < mask.height(); ++y) {
+        for (int x = 0; x < mask.width(); ++x) {
+            if (!mask.testBit(x, y))
+                continue;
+            const bool covered = std::any_of(regions.cbegin(), regions.cend(),
+                                             [&](const QRect &r) { return r.contains(x, y); });
+            if (!covered)
+                return QString("pixel %1,%2 is in no region").arg(x).arg(y);
+        }
+    }
+    return QString();
+}
+
+} // namespace
+
+class MaskRegionsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void randomMasksKeepTheirPromises();
+    void separateClustersStaySeparate();
+    void blankMasksHaveNoRegions();
+    void imageOverloadMatches();
+};
+
+void MaskRegionsTest::randomMasksKeepTheirPromises()
+{
+    // Sizes on both sides of the cell and word boundaries
+    const QSize sizes[] = { QSize(1, 1), QSize(31, 17), QSize(64, 64), QSize(65, 33), QSize(300, 200) };
+    quint32 seed = 1;
+    for (const QSize &size : sizes) {
+        for (int i = 0; i < 20; ++i) {
+            const BitMask mask = randomBlobs(size, seed++);
+            const QString problem = checkRegions(mask, maskRegions(mask));
+            QVERIFY2(problem.isEmpty(), qPrintable(QString("%1x%2 seed %3: %4")
+                                                       .arg(size.width()).arg(size.height())
+                                                       .arg(seed - 1).arg(problem)));
+        }
+    }
+}
+
+// Strokes more than a cell apart get their own rects, so the gap between
+// them is neither blurred nor blended.
+void MaskRegionsTest::separateClustersStaySeparate()
+{
+    BitMask mask(QSize(400, 300));
+    mask.fillRect(QRect(10, 10, 40, 20));
+    mask.fillRect(QRect(200, 150, 30, 30));
+    mask.fillRect(QRect(390, 290, 10, 10));
+
+    QVector<QRect> regions = maskRegions(mask);
+    std::sort(regions.begin(), regions.end(),
+              [](const QRect &a, const QRect &b) { return a.top() < b.top(); });
+    const QVector<QRect> expected = { QRect(10, 10, 40, 20), QRect(200, 150, 30, 30), QRect(390, 290, 10, 10) };
+    QCOMPARE(regions, expected);
+
+    // Clusters whose bounds overlap are united into one
+    BitMask crossing(QSize(400, 300));
+    crossing.fillRect(QRect(0, 0, 300, 1));
+    crossing.fillRect(QRect(299, 0, 1, 200));
+    crossing.fillRect(QRect(100, 100, 1, 1));
+    QCOMPARE(maskRegions(crossing), QVector<QRect>({ QRect(0, 0, 300, 200) }));
+}
+
+void MaskRegionsTest::blankMasksHaveNoRegions()
+{
+    QVERIFY(maskRegions(BitMask()).isEmpty());
+    QVERIFY(maskRegions(BitMask(QSize(130, 70))).isEmpty());
+    QVERIFY(maskRegions(QImage()).isEmpty());
+}
+
+void MaskRegionsTest::imageOverloadMatches()
+{
+    QImage image(QSize(150, 90), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    for (int y = 20; y < 40; ++y) {
+        for (int x = 70; x < 130; ++x)
+            image.setPixel(x, y, qRgba(255, 255, 255, 255));
+    }
+    image.setPixel(3, 80, qRgba(40, 40, 40, 40));
+
+    const QVector<QRect> regions = maskRegions(image);
+    QCOMPARE(regions, maskRegions(BitMask::fromImage(image)));
+    QCOMPARE(regions.size(), 2);
+}
+
+QTEST_APPLESS_MAIN(MaskRegionsTest)
+
+#include "MaskRegionsTest.moc"
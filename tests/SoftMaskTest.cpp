@@ -0,0 +1,274 @@
+// BitMask and SoftMask against the same operations done pixel by pixel on
+// Grayscale8 coverage images.
+
+#include "BandParallel.h"
+#include "BitMask.h"
+#include "SoftMask.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+
+namespace {
+
+// Widths on both sides of the 64-pixel word boundaries
+const QSize kSizes[] = { QSize(1, 1), QSize(63, 5), QSize(64, 7), QSize(65, 3), QSize(130, 97) };
+
+// Mostly empty and full pixels, as strokes are, with partial coverage
+// scattered between; rows of whole empty and full words too.
+QImage randomCoverage(const QSize &size, quint32 seed)
+{
+    QImage image(size, QImage::Format_Grayscale8);
+    QRandomGenerator rng(seed);
+    for (int y = 0; y < image.height(); ++y) {
+        uchar *line = image.scanLine(y);
+        const int kind = rng.bounded(4);
+        for (int x = 0; x < image.width(); ++x) {
+            const int pick = rng.bounded(8);
+            if (kind == 0)
+                line[x] = 0;
+            else if (kind == 1)
+                line[x] = 255;
+            else
+                line[x] = uchar(pick < 3 ? 0 : pick < 6 ? 255 : rng.bounded(256));
+        }
+    }
+    return image;
+}
+
+QImage coverageImage(const SoftMask &mask)
+{
+    QImage image(mask.size(), QImage::Format_Grayscale8);
+    for (int y = 0; y < image.height(); ++y)
+        mask.coverageRow(y, 0, image.width(), image.scanLine(y));
+    return image;
+}
+
+// What the SoftMask operations are specified to do, one pixel at a time
+QImage referenceCombine(const QImage &a, const QImage &b, bool unite)
+{
+    QImage out(a.size(), QImage::Format_Grayscale8);
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            const int ca = a.constScanLine(y)[x];
+            const int cb = b.constScanLine(y)[x];
+            out.scanLine(y)[x] = uchar(unite ? std::max(ca, cb) : (ca * (255 - cb) + 127) / 255);
+        }
+    }
+    return out;
+}
+
+bool bitsMatch(const BitMask &bits, const QImage &coverage)
+{
+    if (bits.size() != coverage.size())
+        return false;
+    for (int y = 0; y < coverage.height(); ++y) {
+        for (int x = 0; x < coverage.width(); ++x) {
+            if (bits.testBit(x, y) != (coverage.constScanLine(y)[x] > 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+QString describe(const QSize &size, quint32 seed)
+{
+    return QString("%1x%2 seed %3").arg(size.width()).arg(size.height()).arg(seed);
+}
+
+} // namespace
+
+class SoftMaskTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void bitMaskMatchesPixels();
+    void softMaskRoundTrip();
+    void coverageRowMatchesPixels();
+    void uniteMatchesPixels();
+    void subtractMatchesPixels();
+    void mismatchedSizeIsIgnored();
+    void fromRectsMatchesPixels();
+};
+
+// Several bands even on a single core, so band edges are exercised
+void SoftMaskTest::initTestCase()
+{
+    setRedactionThreadCount(4);
+}
+
+void SoftMaskTest::cleanupTestCase()
+{
+    setRedactionThreadCount(0);
+}
+
+void SoftMaskTest::bitMaskMatchesPixels()
+{
+    quint32 seed = 1;
+    for (const QSize &size : kSizes) {
+        const QImage a = randomCoverage(size, seed++);
+        const QImage b = randomCoverage(size, seed++);
+        const BitMask bitsA = BitMask::fromImage(a);
+        const BitMask bitsB = BitMask::fromImage(b);
+        QVERIFY2(bitsMatch(bitsA, a), qPrintable(describe(size, seed)));
+
+        BitMask united = bitsA;
+        united |= bitsB;
+        BitMask removed = bitsA;
+        removed.subtract(bitsB);
+
+        qint64 count = 0;
+        QRect bounds;
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x) {
+                const bool inA = a.constScanLine(y)[x] > 0;
+                const bool inB = b.constScanLine(y)[x] > 0;
+                QCOMPARE(united.testBit(x, y), inA || inB);
+                QCOMPARE(removed.testBit(x, y), inA && !inB);
+                if (inA) {
+                    ++count;
+                    bounds |= QRect(x, y, 1, 1);
+                }
+            }
+        }
+        QCOMPARE(bitsA.count(), count);
+        QCOMPARE(bitsA.boundingRect(), bounds);
+    }
+
+    QVERIFY(BitMask(QSize(70, 4)).boundingRect().isNull());
+    QCOMPARE(BitMask(QSize(70, 4)).count(), qint64(0));
+}
+
+void SoftMaskTest::softMaskRoundTrip()
+{
+    quint32 seed = 100;
+    for (const QSize &size : kSizes) {
+        const QImage coverage = randomCoverage(size, seed++);
+        const SoftMask mask = SoftMask::fromImage(coverage);
+        QCOMPARE(mask.size(), size);
+        QVERIFY2(coverageImage(mask) == coverage, qPrintable(describe(size, seed)));
+        QVERIFY(bitsMatch(mask.bits(), coverage));
+
+        // White premultiplied by the coverage, and read back the same way
+        const QImage image = mask.toImage();
+        QCOMPARE(image.format(), QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < size.height(); ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+            for (int x = 0; x < size.width(); ++x) {
+                const int c = coverage.constScanLine(y)[x];
+                QCOMPARE(line[x], qRgba(c, c, c, c));
+            }
+        }
+        QVERIFY(coverageImage(SoftMask::fromImage(image)) == coverage);
+    }
+
+    QVERIFY(SoftMask::fromImage(QImage()).isNull());
+    QVERIFY(SoftMask().toImage().isNull());
+}
+
+void SoftMaskTest::coverageRowMatchesPixels()
+{
+    const QSize size(200, 9);
+    const QImage coverage = randomCoverage(size, 200);
+    const SoftMask mask = SoftMask::fromImage(coverage);
+    QRandomGenerator rng(201);
+    for (int i = 0; i < 500; ++i) {
+        const int y = rng.bounded(size.height());
+        const int x = rng.bounded(size.width());
+        const int n = 1 + rng.bounded(size.width() - x);
+        std::vector<uchar> row(size_t(n), 0);
+        mask.coverageRow(y, x, n, row.data());
+        QVERIFY2(std::equal(row.begin(), row.end(), coverage.constScanLine(y) + x),
+                 qPrintable(QString("row %1 from %2, %3 px").arg(y).arg(x).arg(n)));
+        QCOMPARE(mask.coverage(x, y), int(coverage.constScanLine(y)[x]));
+    }
+}
+
+void SoftMaskTest::uniteMatchesPixels()
+{
+    quint32 seed = 300;
+    for (const QSize &size : kSizes) {
+        const QImage a = randomCoverage(size, seed++);
+        const QImage b = randomCoverage(size, seed++);
+        SoftMask mask = SoftMask::fromImage(a);
+        mask |= SoftMask::fromImage(b);
+
+        const QImage expected = referenceCombine(a, b, true);
+        QVERIFY2(coverageImage(mask) == expected, qPrintable(describe(size, seed)));
+        QVERIFY(bitsMatch(mask.bits(), expected));
+    }
+}
+
+// Subtraction can round partial coverage down to zero; those pixels must
+// leave bits() too, or maskRegions() would keep them.
+void SoftMaskTest::subtractMatchesPixels()
+{
+    quint32 seed = 400;
+    for (const QSize &size : kSizes) {
+        const QImage a = randomCoverage(size, seed++);
+        const QImage b = randomCoverage(size, seed++);
+        SoftMask mask = SoftMask::fromImage(a);
+        mask.subtract(SoftMask::fromImage(b));
+
+        const QImage expected = referenceCombine(a, b, false);
+        QVERIFY2(coverageImage(mask) == expected, qPrintable(describe(size, seed)));
+        QVERIFY(bitsMatch(mask.bits(), expected));
+
+        // And the result keeps working as an operand
+        mask |= SoftMask::fromImage(b);
+        QVERIFY(coverageImage(mask) == referenceCombine(expected, b, true));
+    }
+}
+
+void SoftMaskTest::mismatchedSizeIsIgnored()
+{
+    const QImage coverage = randomCoverage(QSize(70, 6), 500);
+    SoftMask mask = SoftMask::fromImage(coverage);
+    mask |= SoftMask::fromImage(randomCoverage(QSize(71, 6), 501));
+    mask.subtract(SoftMask());
+    QVERIFY(coverageImage(mask) == coverage);
+
+    SoftMask null;
+    null |= mask;
+    QVERIFY(null.isNull());
+}
+
+// Rects inside one word, across several, touching the edges, partly and
+// wholly outside, and empty
+void SoftMaskTest::fromRectsMatchesPixels()
+{
+    const QSize size(200, 40);
+    const QVector<QRect> rects = {
+        QRect(3, 2, 10, 4),   QRect(60, 5, 8, 3),    QRect(63, 10, 2, 2), QRect(10, 15, 170, 3),
+        QRect(128, 20, 64, 2), QRect(-5, 30, 20, 20), QRect(190, -3, 40, 6), QRect(300, 0, 5, 5),
+        QRect(50, 25, 0, 4),
+    };
+    const SoftMask mask = SoftMask::fromRects(size, rects);
+
+    QImage expected(size, QImage::Format_Grayscale8);
+    expected.fill(0);
+    for (const QRect &rect : rects) {
+        const QRect r = rect & QRect(QPoint(0, 0), size);
+        for (int y = r.top(); y <= r.bottom(); ++y) {
+            for (int x = r.left(); x <= r.right(); ++x)
+                expected.scanLine(y)[x] = 255;
+        }
+    }
+    QVERIFY(coverageImage(mask) == expected);
+    QVERIFY(bitsMatch(mask.bits(), expected));
+
+    // Combines with stroke masks like any other
+    const QImage strokes = randomCoverage(size, 600);
+    SoftMask combined = mask;
+    combined.subtract(SoftMask::fromImage(strokes));
+    QVERIFY(coverageImage(combined) == referenceCombine(expected, strokes, false));
+}
+
+QTEST_APPLESS_MAIN(SoftMaskTest)
+
+#include "SoftMaskTest.moc"
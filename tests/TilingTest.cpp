@@ -0,0 +1,185 @@
+// Tile layout and cross-tile merging for sliced detection, and the areas a
+// coarse-to-fine run looks at again.
+
+#include "Tiling.h"
+
+#include <QtTest>
+
+#include <algorithm>
+
+namespace {
+
+DetectionResult detection(const QRect &box, float confidence, int classId = 0)
+{
+    DetectionResult r;
+    r.box = box;
+    r.confidence = confidence;
+    r.classId = classId;
+    return r;
+}
+
+} // namespace
+
+class TilingTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void tilesCoverTheImage();
+    void smallImagesGetOneTile();
+    void mergeAbsorbsClippedHalves();
+    void mergeKeepsDistinctObjects();
+    void refinementCoversWeakCandidates();
+    void refinementUnitesAndCaps();
+};
+
+// Every pixel in some tile, every tile full size and inside the image, and
+// neighbours sharing at least the requested overlap
+void TilingTest::tilesCoverTheImage()
+{
+    struct Case { QSize image; int tile; float overlap; };
+    const Case cases[] = {
+        { QSize(4000, 3000), 640, 0.2f },
+        { QSize(1281, 641), 640, 0.2f },
+        { QSize(2000, 700), 640, 0.0f },
+        { QSize(5000, 900), 640, 0.5f },
+    };
+    for (const Case &c : cases) {
+        const QVector<QRect> tiles = computeTiles(c.image, c.tile, c.overlap);
+        const QRect bounds(QPoint(0, 0), c.image);
+        const QString name = QString("%1x%2 tile %3").arg(c.image.width()).arg(c.image.height()).arg(c.tile);
+
+        QVector<int> xs;
+        QVector<int> ys;
+        for (const QRect &t : tiles) {
+            QVERIFY2(bounds.contains(t), qPrintable(name));
+            QCOMPARE(t.size(), QSize(c.tile, c.tile));
+            if (!xs.contains(t.x()))
+                xs.push_back(t.x());
+            if (!ys.contains(t.y()))
+                ys.push_back(t.y());
+        }
+        // A grid: one tile per origin pair
+        QCOMPARE(tiles.size(), xs.size() * ys.size());
+
+        const int minOverlap = int(c.tile * c.overlap);
+        for (QVector<int> *origins : { &xs, &ys }) {
+            std::sort(origins->begin(), origins->end());
+            QCOMPARE(origins->first(), 0);
+            for (int i = 1; i < origins->size(); ++i)
+                QVERIFY2(origins->at(i - 1) + c.tile - origins->at(i) >= minOverlap, qPrintable(name));
+        }
+        QCOMPARE(xs.last() + c.tile, c.image.width());
+        QCOMPARE(ys.last() + c.tile, c.image.height());
+    }
+}
+
+void TilingTest::smallImagesGetOneTile()
+{
+    QCOMPARE(computeTiles(QSize(640, 480), 640, 0.2f), QVector<QRect>({ QRect(0, 0, 640, 480) }));
+
+    // Short in one direction only: one row of full-width tiles, cut in height
+    const QVector<QRect> strip = computeTiles(QSize(2000, 300), 640, 0.2f);
+    QVERIFY(strip.size() > 1);
+    for (const QRect &t : strip)
+        QCOMPARE(t.size(), QSize(640, 300));
+
+    QVERIFY(computeTiles(QSize(), 640, 0.2f).isEmpty());
+    QVERIFY(computeTiles(QSize(800, 800), 0, 0.2f).isEmpty());
+}
+
+// The part of an object cut by a tile edge lies inside the whole object
+// from the next tile; measured against the smaller box it overlaps fully.
+void TilingTest::mergeAbsorbsClippedHalves()
+{
+    std::vector<DetectionResult> results = {
+        detection(QRect(600, 100, 40, 80), 0.55f),  // clipped at the tile edge
+        detection(QRect(600, 100, 90, 80), 0.8f),   // whole, from the next tile
+        detection(QRect(602, 98, 88, 84), 0.6f),    // the full-frame pass's copy
+    };
+    mergeDetections(results, 0.6f);
+    QCOMPARE(int(results.size()), 1);
+    QCOMPARE(results.front().box, QRect(600, 100, 90, 80));
+    QCOMPARE(results.front().confidence, 0.8f);
+}
+
+void TilingTest::mergeKeepsDistinctObjects()
+{
+    std::vector<DetectionResult> results = {
+        detection(QRect(0, 0, 100, 100), 0.4f),
+        detection(QRect(50, 0, 100, 100), 0.9f),       // half overlapping: kept at 0.6
+        detection(QRect(10, 10, 50, 50), 0.7f, 1),     // another class
+        detection(QRect(500, 500, 20, 20), 0.3f),
+        detection(QRect(500, 500, 20, 0), 0.95f),      // empty box never absorbs
+    };
+    mergeDetections(results, 0.6f);
+    QCOMPARE(int(results.size()), 5);
+    for (size_t i = 1; i < results.size(); ++i)
+        QVERIFY(results[i - 1].confidence >= results[i].confidence);
+
+    // At exactly the threshold the weaker box goes
+    std::vector<DetectionResult> edge = {
+        detection(QRect(0, 0, 100, 100), 0.9f),
+        detection(QRect(40, 0, 100, 100), 0.5f),
+    };
+    mergeDetections(edge, 0.6f);
+    QCOMPARE(int(edge.size()), 1);
+}
+
+// Only weak candidates, padded by their size, grown to a model input and
+// slid back inside the image rather than cut
+void TilingTest::refinementCoversWeakCandidates()
+{
+    const QSize image(4000, 3000);
+    const std::vector<DetectionResult> candidates = {
+        detection(QRect(1000, 1000, 100, 50), 0.3f),
+        detection(QRect(3000, 200, 40, 40), 0.9f),   // confident: left alone
+        detection(QRect(3950, 2980, 40, 20), 0.2f),  // in the corner
+        detection(QRect(2000, 2000, 0, 30), 0.1f),   // empty box
+    };
+    std::vector<QRect> regions = refinementRegions(image, candidates, 0.5f, 1.0f, 640, 8);
+    QCOMPARE(int(regions.size()), 2);
+    std::sort(regions.begin(), regions.end(),
+              [](const QRect &a, const QRect &b) { return a.x() < b.x(); });
+
+    // 300 x 150 after padding, then 640 x 640 around the same centre
+    QCOMPARE(regions[0], QRect(730, 705, 640, 640));
+    // Full size, pushed into the corner
+    QCOMPARE(regions[1], QRect(3360, 2360, 640, 640));
+
+    // Larger than the image: clipped to it, still around the padded box
+    const std::vector<QRect> clipped = refinementRegions(QSize(500, 400), { detection(QRect(100, 100, 50, 50), 0.1f) },
+                                                         0.5f, 1.0f, 640, 8);
+    QCOMPARE(int(clipped.size()), 1);
+    QVERIFY(QRect(0, 0, 500, 400).contains(clipped.front()));
+    QVERIFY(clipped.front().contains(QRect(50, 50, 150, 150)));
+}
+
+void TilingTest::refinementUnitesAndCaps()
+{
+    const QSize image(6000, 4000);
+
+    // Two nearby candidates share one area covering both
+    const std::vector<QRect> united = refinementRegions(
+        image, { detection(QRect(1000, 1000, 50, 50), 0.2f), detection(QRect(1500, 1100, 50, 50), 0.3f) },
+        0.5f, 1.0f, 640, 8);
+    QCOMPARE(int(united.size()), 1);
+    QVERIFY(united.front().contains(QRect(1000, 1000, 50, 50)));
+    QVERIFY(united.front().contains(QRect(1500, 1100, 50, 50)));
+
+    // Over the cap, the strongest of the weak candidates keep their areas
+    std::vector<DetectionResult> spread;
+    for (int i = 0; i < 6; ++i)
+        spread.push_back(detection(QRect(100 + 900 * i, 2000, 60, 60), 0.1f + 0.05f * i));
+    const std::vector<QRect> capped = refinementRegions(image, spread, 0.5f, 1.0f, 640, 3);
+    QCOMPARE(int(capped.size()), 3);
+    for (int i = 3; i < 6; ++i) {
+        const bool kept = std::any_of(capped.cbegin(), capped.cend(),
+                                      [&](const QRect &r) { return r.contains(spread[size_t(i)].box); });
+        QVERIFY2(kept, qPrintable(QString("candidate %1").arg(i)));
+    }
+}
+
+QTEST_APPLESS_MAIN(TilingTest)
+
+#include "TilingTest.moc"
@@ -0,0 +1,225 @@
+// postprocessYolo() against a plain argmax and greedy per-class NMS, for
+// both output layouts.
+
+#include "YoloPostprocess.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int kClasses = 7;
+constexpr int kChannels = 4 + kClasses;
+
+// A head in channel-major layout: boxes bunched around a few centres so
+// NMS has work to do, scores spread so some anchors pass every threshold.
+// Odd anchor counts run the vector scan into its scalar tail.
+std::vector<float> randomHead(int anchors, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+    std::vector<float> head(size_t(kChannels) * anchors);
+    const auto at = [&](int c, int i) -> float & { return head[size_t(c) * anchors + i]; };
+    for (int i = 0; i < anchors; ++i) {
+        const int centre = rng.bounded(5);
+        at(0, i) = float(100 + 100 * centre + rng.bounded(30));
+        at(1, i) = float(150 + 60 * centre + rng.bounded(30));
+        at(2, i) = float(20 + rng.bounded(80));
+        at(3, i) = float(20 + rng.bounded(80));
+        for (int c = 4; c < kChannels; ++c)
+            at(c, i) = float(rng.generateDouble() * rng.generateDouble());
+    }
+    return head;
+}
+
+std::vector<float> transposed(const std::vector<float> &head, int anchors)
+{
+    std::vector<float> out(head.size());
+    for (int i = 0; i < anchors; ++i) {
+        for (int c = 0; c < kChannels; ++c)
+            out[size_t(i) * kChannels + c] = head[size_t(c) * anchors + i];
+    }
+    return out;
+}
+
+struct RefBox
+{
+    float x1, y1, x2, y2;
+    float score;
+    int classId;
+};
+
+float refIou(const RefBox &a, const RefBox &b)
+{
+    const float ix = std::max(0.0f, std::min(a.x2, b.x2) - std::max(a.x1, b.x1));
+    const float iy = std::max(0.0f, std::min(a.y2, b.y2) - std::max(a.y1, b.y1));
+    const float inter = ix * iy;
+    const float uni = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1) - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// What postprocessYolo() is specified to do, written the slow way
+std::vector<DetectionResult> reference(const std::vector<float> &head, int anchors,
+                                       const LetterboxTransform &lb, const QSize &imageSize,
+                                       const YoloPostprocessOptions &options)
+{
+    const auto at = [&](int c, int i) { return head[size_t(c) * anchors + i]; };
+    std::vector<RefBox> candidates;
+    for (int i = 0; i < anchors; ++i) {
+        int best = 0;
+        for (int c = 1; c < kClasses; ++c) {
+            if (at(4 + c, i) > at(4 + best, i))
+                best = c;
+        }
+        const float score = at(4 + best, i);
+        if (score < options.confThreshold)
+            continue;
+        const float cx = at(0, i), cy = at(1, i), bw = at(2, i), bh = at(3, i);
+        const float inv = 1.0f / lb.scale;
+        const float w = float(imageSize.width());
+        const float h = float(imageSize.height());
+        candidates.push_back({ std::clamp((cx - bw / 2 - lb.padX) * inv, 0.0f, w),
+                               std::clamp((cy - bh / 2 - lb.padY) * inv, 0.0f, h),
+                               std::clamp((cx + bw / 2 - lb.padX) * inv, 0.0f, w),
+                               std::clamp((cy + bh / 2 - lb.padY) * inv, 0.0f, h), score, best });
+    }
+
+    const auto byScore = [](const RefBox &a, const RefBox &b) { return a.score > b.score; };
+    std::sort(candidates.begin(), candidates.end(), byScore);
+    if (options.maxCandidates > 0 && candidates.size() > size_t(options.maxCandidates))
+        candidates.resize(size_t(options.maxCandidates));
+
+    std::vector<RefBox> kept;
+    for (const RefBox &c : candidates) {
+        const bool suppressed = std::any_of(kept.cbegin(), kept.cend(), [&](const RefBox &k) {
+            return k.classId == c.classId && refIou(k, c) > options.iouThreshold;
+        });
+        if (!suppressed)
+            kept.push_back(c);
+    }
+    if (options.maxDetections > 0 && kept.size() > size_t(options.maxDetections))
+        kept.resize(size_t(options.maxDetections));
+
+    std::vector<DetectionResult> results;
+    for (const RefBox &b : kept) {
+        DetectionResult r;
+        r.box = QRect(int(std::lround(b.x1)), int(std::lround(b.y1)),
+                      int(std::lround(b.x2 - b.x1)), int(std::lround(b.y2 - b.y1)));
+        r.confidence = b.score;
+        r.classId = b.classId;
+        results.push_back(r);
+    }
+    return results;
+}
+
+QString describe(const std::vector<DetectionResult> &results, const std::vector<DetectionResult> &expected)
+{
+    if (results.size() != expected.size())
+        return QString("%1 results, expected %2").arg(results.size()).arg(expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const DetectionResult &a = results[i];
+        const DetectionResult &b = expected[i];
+        if (a.box != b.box || a.confidence != b.confidence || a.classId != b.classId)
+            return QString("result %1 differs").arg(i);
+    }
+    return QString();
+}
+
+} // namespace
+
+class YoloPostprocessTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesReference();
+    void layoutsAgree();
+    void emptyOutputGivesNothing();
+};
+
+void YoloPostprocessTest::matchesReference()
+{
+    const LetterboxTransform lb{ 0.5f, 0, 80 };
+    const QSize imageSize(1280, 960);
+
+    struct Case { int anchors; float conf; float iou; int maxCandidates; int maxDetections; };
+    const Case cases[] = {
+        { 1, 0.0f, 0.7f, 30000, 300 },
+        { 1003, 0.25f, 0.7f, 30000, 300 },
+        { 1003, 0.1f, 0.45f, 30000, 300 },
+        { 2048, 0.05f, 0.5f, 200, 300 }, // capped before NMS
+        { 2048, 0.05f, 0.5f, 30000, 10 }, // capped after
+        { 517, 0.99f, 0.7f, 30000, 300 }, // nearly nothing passes
+    };
+    quint32 seed = 1;
+    for (const Case &c : cases) {
+        const std::vector<float> head = randomHead(c.anchors, seed++);
+        YoloPostprocessOptions options;
+        options.confThreshold = c.conf;
+        options.iouThreshold = c.iou;
+        options.maxCandidates = c.maxCandidates;
+        options.maxDetections = c.maxDetections;
+
+        YoloOutput output;
+        output.data = head.data();
+        output.channels = kChannels;
+        output.anchors = c.anchors;
+
+        std::vector<DetectionResult> results;
+        postprocessYolo(output, lb, imageSize, options, results);
+        const QString problem = describe(results, reference(head, c.anchors, lb, imageSize, options));
+        QVERIFY2(problem.isEmpty(), qPrintable(QString("%1 anchors conf %2 iou %3: %4")
+                                                   .arg(c.anchors).arg(c.conf).arg(c.iou).arg(problem)));
+    }
+}
+
+// The transposed [anchors, channels] export decodes to the same boxes
+void YoloPostprocessTest::layoutsAgree()
+{
+    const int anchors = 1501;
+    const std::vector<float> head = randomHead(anchors, 100);
+    const std::vector<float> anchorMajor = transposed(head, anchors);
+    const LetterboxTransform lb{ 0.75f, 16, 0 };
+    const QSize imageSize(832, 853);
+    const YoloPostprocessOptions options;
+
+    YoloOutput output;
+    output.channels = kChannels;
+    output.anchors = anchors;
+
+    std::vector<DetectionResult> channelMajorResults;
+    output.data = head.data();
+    postprocessYolo(output, lb, imageSize, options, channelMajorResults);
+
+    std::vector<DetectionResult> anchorMajorResults;
+    output.data = anchorMajor.data();
+    output.channelMajor = false;
+    postprocessYolo(output, lb, imageSize, options, anchorMajorResults);
+
+    QVERIFY(!channelMajorResults.empty());
+    QVERIFY2(describe(anchorMajorResults, channelMajorResults).isEmpty(),
+             qPrintable(describe(anchorMajorResults, channelMajorResults)));
+}
+
+void YoloPostprocessTest::emptyOutputGivesNothing()
+{
+    std::vector<DetectionResult> results(3);
+    postprocessYolo(YoloOutput(), LetterboxTransform(), QSize(640, 640), YoloPostprocessOptions(), results);
+    QVERIFY(results.empty());
+
+    // A head with boxes but no class channel
+    const std::vector<float> boxesOnly(4 * 10, 1.0f);
+    YoloOutput output;
+    output.data = boxesOnly.data();
+    output.channels = 4;
+    output.anchors = 10;
+    postprocessYolo(output, LetterboxTransform(), QSize(640, 640), YoloPostprocessOptions(), results);
+    QVERIFY(results.empty());
+}
+
+QTEST_APPLESS_MAIN(YoloPostprocessTest)
+
+#include "YoloPostprocessTest.moc"